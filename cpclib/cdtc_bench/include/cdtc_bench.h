@@ -0,0 +1,28 @@
+#ifndef __CDTC_BENCH_H__
+#define __CDTC_BENCH_H__
+
+#include <stdint.h>
+
+/* Markers for benchmarks measured in cdtc_sim, to the T-state.
+
+     cdtc_bench_begin (1);
+     fill_table ();
+     cdtc_bench_end ();
+
+   Set CDTC_BENCH_CALLS=_bench (the routines to run) in
+   cdtc_project.conf, then "make bench-cycles" writes foo.cycles.txt,
+   with the T-states and NOPs of each region.  A region starts when
+   cdtc_bench_begin returns and ends when cdtc_bench_end is called: the
+   markers themselves do not count.  Regions may nest, and run any
+   number of times.
+
+   The markers only return: on a CPC or in an emulator they cost a
+   call and a return, and change no register. */
+
+/** Start region number REGION (0-255). */
+void cdtc_bench_begin (uint8_t region) __z88dk_fastcall __preserves_regs(a, b, c, d, e, h, l, iyh, iyl);
+
+/** End the region started last. */
+void cdtc_bench_end (void) __preserves_regs(a, b, c, d, e, h, l, iyh, iyl);
+
+#endif /* __CDTC_BENCH_H__ */
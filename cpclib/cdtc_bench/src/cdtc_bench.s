@@ -0,0 +1,13 @@
+	.module cdtc_bench
+
+	.area _CODE
+
+; void cdtc_bench_begin (uint8_t region) __z88dk_fastcall;
+; void cdtc_bench_end (void);
+; Markers for cdtc_sim --bench, see cdtc_bench.h.  They do nothing:
+; the simulator recognizes their addresses.
+_cdtc_bench_begin::
+	ret
+
+_cdtc_bench_end::
+	ret
@@ -0,0 +1,134 @@
+	.module cdtc_fwoff_crt0
+
+; crt0 for programs that run with the firmware switched off, see
+; cdtc_fwoff.h.  Linked first, instead of the project's crt0.s, when
+; cdtc_project.conf has CDTC_FIRMWARE=off.
+;
+; The firmware keeps &A700-&BFFF for itself and spends time in its
+; ticker and event handlers at each interrupt.  Here, once loaded, the
+; program owns &0040-&BFFF: the stack starts at &C000 and grows down,
+; variables may use what is left between the end of the program and
+; the stack.  The interrupt vector at &0038 points to a minimal handler
+; that only counts frames and calls an optional handler at each frame.
+; Interrupts are not shared with anything else.
+;
+; There is no way back to BASIC: when main returns the program stops
+; with interrupts still running.
+
+	.globl _main
+
+	.area	_CODE
+
+cpc_run_address::
+	di
+	ld	sp, #0xC000
+
+	;; Lower and upper ROM off, mode 1 (the screen mode cannot be
+	;; read back from the gate array).  From now on &0000-&3FFF and
+	;; &C000-&FFFF read RAM.
+	ld	bc, #0x7F8D
+	out	(c), c
+
+	;; AMSDOS leaves the disc motor running after loading, the
+	;; firmware ticker would have stopped it two seconds later.
+	ld	bc, #0xFA7E
+	xor	a, a
+	out	(c), a
+
+	ld	hl, #0
+	ld	(_cdtc_fwoff_frames), hl
+	ld	(_cdtc_fwoff_frame_handler), hl
+
+	;; IM 1 jumps to &0038, replace the firmware handler there.
+	ld	a, #0xC3		; jp
+	ld	(0x0038), a
+	ld	hl, #cdtc_fwoff_interrupt
+	ld	(0x0039), hl
+	im	1
+
+	call	gsinit
+	ei
+	call	_main
+stop$:
+	halt
+	jr	stop$
+
+; The gate array interrupts 300 times per second.  One of the six in a
+; frame comes while the VSYNC bit of PPI port B is set: it counts the
+; frame and calls the frame handler, if any.  The others only return.
+; The frame handler may be C code, it runs with interrupts off and must
+; leave the alternate registers alone.
+cdtc_fwoff_interrupt::
+	push	af
+	push	bc
+	ld	b, #0xF5
+	in	a, (c)
+	rra
+	jr	nc, not_vsync$
+	push	de
+	push	hl
+	push	iy
+	ld	hl, (_cdtc_fwoff_frames)
+	inc	hl
+	ld	(_cdtc_fwoff_frames), hl
+	ld	hl, (_cdtc_fwoff_frame_handler)
+	ld	a, h
+	or	a, l
+	call	nz, call_hl$
+	pop	iy
+	pop	hl
+	pop	de
+not_vsync$:
+	pop	bc
+	pop	af
+	ei
+	ret
+call_hl$:
+	jp	(hl)
+
+; void cdtc_fwoff_wait_frame (void);
+; Wait for the next frame, i.e. the start of VSYNC.
+_cdtc_fwoff_wait_frame::
+	ld	hl, #_cdtc_fwoff_frames
+	ld	a, (hl)
+wait$:
+	halt
+	cp	a, (hl)
+	jr	z, wait$
+	ret
+
+	;; Initialized variables are copied as by the crt0 of
+	;; tests/xmacro.
+	.area   _GSINIT
+
+	.globl l__INITIALIZER
+	.globl s__INITIALIZED
+	.globl s__INITIALIZER
+
+gsinit::
+	ld	bc, #l__INITIALIZER
+	ld	a, b
+	or	a, c
+	jr	Z, gsinit_next
+	ld	de, #s__INITIALIZED
+	ld	hl, #s__INITIALIZER
+	ldir
+gsinit_next:
+
+	.area   _GSFINAL
+	ret
+
+	;; _DATA comes last: it is not loaded, so it may grow past
+	;; &A67F, where AMSDOS stops loading, up to the stack.
+	.area 	_HOME
+	.area   _INITIALIZER
+	.area   _INITIALIZED
+	.area	_AFTERCODE
+_aftercode::
+
+	.area	_DATA
+
+_cdtc_fwoff_frames::
+	.ds	2
+_cdtc_fwoff_frame_handler::
+	.ds	2
@@ -0,0 +1,50 @@
+#ifndef __CDTC_FWOFF_H__
+#define __CDTC_FWOFF_H__
+
+#include <stdint.h>
+
+/* Run without the firmware: set CDTC_FIRMWARE=off in cdtc_project.conf.
+
+   The program is then started by cdtc_fwoff_crt0.s, which switches the
+   ROMs off, puts the stack at &C000 and installs its own interrupt
+   handler.  The program is linked from &0040 and its variables may go
+   up to the stack: no firmware call (cfwi, printf) works any more, and
+   main must not return.
+
+   The functions below replace the firmware for the screen mode, inks
+   and keyboard.  They talk to the hardware directly. */
+
+/** Frames since start, counted at each VSYNC by the interrupt handler. */
+extern volatile uint16_t cdtc_fwoff_frames;
+
+/** Called at each VSYNC from the interrupt handler, with interrupts
+    off, when not null.  Keep it short: the next interrupt comes 52
+    scan lines later. */
+extern void (*volatile cdtc_fwoff_frame_handler) (void);
+
+/** Wait for the next VSYNC. */
+void cdtc_fwoff_wait_frame (void) __preserves_regs(b, c, d, e, iyh, iyl);
+
+/** Screen mode 0, 1 or 2.  Takes effect at the next scan line. */
+void cdtc_fwoff_set_mode (uint8_t mode) __z88dk_fastcall __preserves_regs(d, e, h, l, iyh, iyl);
+
+/** Colour of a pen (0-15), numbered as for the firmware and BASIC
+    INK (0-26).  No flashing. */
+void cdtc_fwoff_set_ink (uint8_t pen, uint8_t colour) __preserves_regs(iyh, iyl);
+
+/** Border colour, numbered as for BASIC BORDER (0-26). */
+void cdtc_fwoff_set_border (uint8_t colour) __z88dk_fastcall __preserves_regs(iyh, iyl);
+
+/** Keyboard matrix state after the last cdtc_fwoff_scan_keyboard(). */
+extern uint8_t cdtc_fwoff_keys[10];
+
+/** Read the keyboard matrix into cdtc_fwoff_keys.  About 320 NOPs:
+    call it once per frame, e.g. from the frame handler. */
+void cdtc_fwoff_scan_keyboard (void) __preserves_regs(iyh, iyl);
+
+/** Non-zero if the key, numbered as for the firmware and BASIC INKEY
+    (0-79), was down at the last scan. */
+#define cdtc_fwoff_key_pressed(key) \
+	(cdtc_fwoff_keys[(key) >> 3] & (1 << ((key) & 7)))
+
+#endif /* __CDTC_FWOFF_H__ */
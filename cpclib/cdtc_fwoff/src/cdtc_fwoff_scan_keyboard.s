@@ -0,0 +1,56 @@
+	.module cdtc_fwoff_scan_keyboard
+
+	.area _CODE
+
+; void cdtc_fwoff_scan_keyboard (void);
+; Read the 10 lines of the keyboard matrix through the PSG I/O port
+; into cdtc_fwoff_keys, one bit set per key pressed.  Bit b of byte l is
+; the key numbered 8 * l + b by the firmware (and BASIC's INKEY).  The
+; PSG is borrowed: do not call this while a frame handler may play
+; music.  Interrupts are held off during the scan, then restored.
+_cdtc_fwoff_scan_keyboard::
+	; P/V = interrupts enabled.  On the NMOS Z80, an interrupt taken
+	; during ld a, i clears P/V: enabled if either of two reads says so.
+	ld	a, i
+	jp	pe, iff$
+	ld	a, i
+iff$:
+	push	af
+	di
+	ld	bc, #0xF40E		; PSG register 14, the I/O port
+	out	(c), c
+	ld	bc, #0xF6C0		; latch register
+	out	(c), c
+	ld	bc, #0xF600		; inactive
+	out	(c), c
+	ld	bc, #0xF792		; PPI port A in, to read the PSG
+	out	(c), c
+	ld	hl, #_cdtc_fwoff_keys
+	ld	a, #0x40		; PSG read, keyboard line 0
+line$:
+	ld	b, #0xF6
+	out	(c), a
+	ld	b, #0xF4
+	in	d, (c)
+	ld	e, a
+	ld	a, d
+	cpl				; a key pressed reads as 0
+	ld	(hl), a
+	inc	hl
+	ld	a, e
+	inc	a
+	cp	a, #0x4A
+	jr	nz, line$
+	ld	bc, #0xF782		; PPI port A back to output
+	out	(c), c
+	ld	bc, #0xF600
+	out	(c), c
+	pop	af
+	ret	po
+	ei
+	ret
+
+	.area _DATA
+
+_cdtc_fwoff_keys::
+	.ds	10
@@ -0,0 +1,37 @@
+	.module cdtc_fwoff_set_ink
+
+	.area _CODE
+
+; void cdtc_fwoff_set_ink (uint8_t pen, uint8_t colour);
+; Colours are numbered as for the firmware and BASIC (0-26), pen 16 is
+; the border.  No flashing inks.
+_cdtc_fwoff_set_ink::
+	ld	hl, #3
+	add	hl, sp
+	ld	e, (hl)
+	dec	hl
+	ld	a, (hl)
+	and	a, #0x1F
+	jr	set_pen$
+
+; void cdtc_fwoff_set_border (uint8_t colour) __z88dk_fastcall;
+_cdtc_fwoff_set_border::
+	ld	e, l
+	ld	a, #0x10
+
+; A = pen, E = firmware colour number.
+set_pen$:
+	ld	d, #0
+	ld	hl, #hardware_colours$
+	add	hl, de
+	ld	bc, #0x7F00
+	out	(c), a			; gate array register 0: select pen
+	ld	a, (hl)
+	out	(c), a			; register 1: its colour
+	ret
+
+; Gate array colour of each firmware colour number, with bit 6 set.
+hardware_colours$:
+	.db	0x54, 0x44, 0x55, 0x5C, 0x58, 0x5D, 0x4C, 0x45, 0x4D
+	.db	0x56, 0x46, 0x57, 0x5E, 0x40, 0x5F, 0x4E, 0x47, 0x4F
+	.db	0x52, 0x42, 0x53, 0x5A, 0x59, 0x5B, 0x4A, 0x43, 0x4B
@@ -0,0 +1,14 @@
+	.module cdtc_fwoff_set_mode
+
+	.area _CODE
+
+; void cdtc_fwoff_set_mode (uint8_t mode) __z88dk_fastcall;
+; Gate array register 2: screen mode in bits 0-1, bits 2-3 keep lower
+; and upper ROM off.
+_cdtc_fwoff_set_mode::
+	ld	a, l
+	and	a, #0x03
+	or	a, #0x8C
+	ld	bc, #0x7F00
+	out	(c), a
+	ret
@@ -0,0 +1,67 @@
+#!/bin/bash
+
+# Benchmark the cdtc_lz decompressors in cdtc_sim.
+#
+# Usage: bench.sh image.ihx image.map file...
+#
+# image.ihx holds the decompressors, linked low in memory.  Each file
+# (only its first MAXSIZE bytes) is compressed, decompressed by each
+# variant, and the output compared with the original.  Printed for each
+# file and variant: compression ratio, Z80 T-states per byte and CPC
+# NOPs (microseconds) per byte of output.
+
+set -eu -o pipefail
+
+IMAGE="$1"
+MAP="$2"
+shift 2
+
+MAXSIZE=24000
+DST='&0800'
+SRC='&7000'
+
+WORKDIR="$( mktemp -d )"
+trap 'rm -rf "$WORKDIR"' EXIT
+
+# cdtc_sim prints "... after N instructions, T T-states, NOPS NOPs".
+function run_variant()
+{
+    local VARIANT="$1" LENGTH="$2" LOG
+    shift 2
+    LOG="${WORKDIR}/sim.log"
+    cdtc_sim -l "$IMAGE" -m "$MAP" "$@" -c "_cdtc_lz_unpack_${VARIANT}" \
+             -d "${DST}:${LENGTH}:${WORKDIR}/out" >"$LOG"
+    if ! grep -q ": returned at" "$LOG"
+    then
+        cat >&2 "$LOG"
+        echo >&2 "bench.sh: ${VARIANT} did not return"
+        exit 1
+    fi
+    if ! cmp -s "${WORKDIR}/in" "${WORKDIR}/out"
+    then
+        echo >&2 "bench.sh: ${VARIANT} output differs from the original"
+        exit 1
+    fi
+    sed -n 's/.* \([0-9]*\) T-states, \([0-9]*\) NOPs$/\1 \2/p' "$LOG" \
+    | { read T NOPS ; awk -v t="$T" -v n="$NOPS" -v l="$LENGTH" 'BEGIN { printf " %7.2f %7.2f", t / l, n / l }' ; }
+}
+
+printf "%-32s %6s %6s %6s  %-15s  %-15s  %-15s\n" "" "" "" "" "fast" "small" "inplace"
+printf "%-32s %6s %6s %6s  %15s  %15s  %15s\n" "file" "bytes" "packed" "ratio" "T/byte NOP/byte" "T/byte NOP/byte" "T/byte NOP/byte"
+
+for FILE in "$@"
+do
+    head -c "$MAXSIZE" "$FILE" >"${WORKDIR}/in"
+    LENGTH=$( wc -c <"${WORKDIR}/in" | tr -d ' ' )
+    [[ "$LENGTH" != 0 ]] || continue
+    cdtc_lz "${WORKDIR}/in" "${WORKDIR}/in.lz" >/dev/null
+    cdtc_lz --inplace "${WORKDIR}/in" "${WORKDIR}/in.lzi" >/dev/null
+    PACKED=$( wc -c <"${WORKDIR}/in.lz" | tr -d ' ' )
+    printf "%-32s %6d %6d %5d%%" "$( basename "$FILE" )" "$LENGTH" "$PACKED" $(( PACKED * 100 / LENGTH ))
+    for VARIANT in fast small
+    do
+        run_variant "$VARIANT" "$LENGTH" -l "${WORKDIR}/in.lz@${SRC}" -a "$SRC" -a "$DST"
+    done
+    run_variant inplace "$LENGTH" -l "${WORKDIR}/in.lzi@${DST}" -a "$DST"
+    echo
+done
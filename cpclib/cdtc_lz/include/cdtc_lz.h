@@ -0,0 +1,24 @@
+#ifndef __CDTC_LZ_H__
+#define __CDTC_LZ_H__
+
+/* Decompressors for streams made by tool/cdtc_lz (cdtc_lz input output).
+
+   All variants write the original data to dst and return.  dst must
+   not overlap src, except with cdtc_lz_unpack_inplace.
+
+   Typical speed on a CPC, see "make bench" in cpclib/cdtc_lz:
+   cdtc_lz_unpack_fast is about 10% faster than cdtc_lz_unpack_small,
+   which is about 60% of its size (47 bytes against 78). */
+
+/** Fastest variant. */
+void cdtc_lz_unpack_fast (const void *src, void *dst) __preserves_regs(iyh, iyl);
+
+/** Smallest variant. */
+void cdtc_lz_unpack_small (const void *src, void *dst) __preserves_regs(iyh, iyl);
+
+/** Decompress a stream made by "cdtc_lz --inplace" in its own buffer.
+    The file is loaded at buffer as is.  buffer must have room for the
+    extent reported by cdtc_lz, a bit more than the original data. */
+void cdtc_lz_unpack_inplace (void *buffer) __preserves_regs(iyh, iyl);
+
+#endif /* __CDTC_LZ_H__ */
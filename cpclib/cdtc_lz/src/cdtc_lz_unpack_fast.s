@@ -0,0 +1,80 @@
+	.module cdtc_lz_unpack_fast
+
+; void cdtc_lz_unpack_fast (const void *src, void *dst);
+; Decompress a cdtc_lz stream, see cdtc_lz_unpack_small.s for the
+; format.  Short and long matches have their own code path and every
+; path fetches the next token itself: larger, but fewer cycles per
+; token.
+
+	.area _CODE
+
+_cdtc_lz_unpack_fast::
+	pop	bc
+	pop	hl
+	pop	de
+	push	de
+	push	hl
+	push	bc
+
+; Entry for assembly callers: HL = source, DE = destination.
+; On return DE points after the last byte written.
+cdtc_lz_unpack_fast_hl_de::
+	ld	b,#0
+token$:
+	ld	a,(hl)
+	inc	hl
+	add	a,a
+	jr	c,match$
+	ret	z
+literals$:
+	rrca
+	ld	c,a
+	ldir
+	; A literal run is followed by a match, unless it was 127 long.
+	ld	a,(hl)
+	inc	hl
+	add	a,a
+	jr	nc,not_a_match$
+match$:
+	; A = token * 2, sign = long offset.
+	jp	m,long$
+	rrca
+	push	hl
+	ld	l,(hl)
+	ld	h,#0xFF
+	add	hl,de
+	add	a,#2
+	ld	c,a
+	ldir
+	pop	hl
+	inc	hl
+	ld	a,(hl)
+	inc	hl
+	add	a,a
+	jr	c,match$
+	ret	z
+	jp	literals$
+long$:
+	rrca
+	ld	c,(hl)
+	inc	hl
+	ld	b,(hl)
+	inc	hl
+	push	hl
+	ld	h,b
+	ld	l,c
+	add	hl,de
+	sub	#0x40 - 3
+	ld	c,a
+	ld	b,#0
+	ldir
+	pop	hl
+	ld	a,(hl)
+	inc	hl
+	add	a,a
+	jr	c,match$
+	ret	z
+	jp	literals$
+not_a_match$:
+	ret	z
+	jp	literals$
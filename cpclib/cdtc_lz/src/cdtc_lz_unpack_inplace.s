@@ -0,0 +1,39 @@
+	.module cdtc_lz_unpack_inplace
+
+; void cdtc_lz_unpack_inplace (void *buffer);
+; Decompress a cdtc_lz stream made by "cdtc_lz --inplace" over itself.
+; The stream comes after a 4-byte header:
+;   word  length of the stream
+;   word  extent: how many bytes of buffer decompression uses
+; The stream is first moved to the end of the extent, then decompressed
+; to the start of buffer.  cdtc_lz chose the extent so that output never
+; overwrites input that is still to be read.
+
+	.area _CODE
+
+_cdtc_lz_unpack_inplace::
+	pop	de
+	pop	hl
+	push	hl
+	push	de
+	ld	c,(hl)
+	inc	hl
+	ld	b,(hl)
+	inc	hl
+	ld	e,(hl)
+	inc	hl
+	ld	d,(hl)
+	push	hl
+	add	hl,de
+	ld	de,#-4
+	add	hl,de
+	ex	de,hl
+	pop	hl
+	add	hl,bc
+	lddr
+	inc	de
+	ex	de,hl
+	dec	de
+	dec	de
+	dec	de
+	jp	cdtc_lz_unpack_small_hl_de
@@ -0,0 +1,56 @@
+	.module cdtc_lz_unpack_small
+
+; void cdtc_lz_unpack_small (const void *src, void *dst);
+; Decompress a cdtc_lz stream.  Smallest variant.
+; Tokens:
+;   &00         end
+;   &01-&7F     that many literal bytes follow
+;   &80-&BF     match of (token & &3F) + 2 bytes, offset &FFxx, xx follows
+;   &C0-&FF     match of (token & &3F) + 3 bytes, 16-bit offset follows
+; Offsets are negative, little endian, added to the output pointer.
+
+	.area _CODE
+
+_cdtc_lz_unpack_small::
+	pop	bc
+	pop	hl
+	pop	de
+	push	de
+	push	hl
+	push	bc
+
+; Entry for assembly callers: HL = source, DE = destination.
+; On return DE points after the last byte written.
+cdtc_lz_unpack_small_hl_de::
+	ld	b,#0
+token$:
+	ld	a,(hl)
+	inc	hl
+	add	a,a
+	jr	c,match$
+	ret	z
+	rrca
+	ld	c,a
+	ldir
+	jr	token$
+match$:
+	rrca
+	ld	c,(hl)
+	inc	hl
+	ld	b,#0xFF
+	cp	#0x40
+	jr	c,short$
+	sub	#0x3F
+	ld	b,(hl)
+	inc	hl
+short$:
+	push	hl
+	ld	h,b
+	ld	l,c
+	add	hl,de
+	add	a,#2
+	ld	c,a
+	ld	b,#0
+	ldir
+	pop	hl
+	jr	token$
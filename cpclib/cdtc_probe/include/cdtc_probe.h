@@ -0,0 +1,36 @@
+#ifndef __CDTC_PROBE_H__
+#define __CDTC_PROBE_H__
+
+#include <stdint.h>
+
+/* Events and counters sent to the host through the probe port, a few
+   NOPs each, instead of text through the printer.
+
+     cdtc_probe_event (1);
+     cdtc_probe_counter16 (2, score);
+
+   No CPC device answers to ports &FF00-&FF02: on a CPC or in cap32 the
+   writes are lost.  cdtc_sim --probe FILE records each one with the
+   NOPs elapsed since the start, and tool/cdtc_probe decodes FILE into
+   text or CSV.  Set CDTC_PROBE_CALLS=_bench (the routines to run) in
+   cdtc_project.conf, then "make probe" writes foo.probe.txt and
+   foo.probe.csv.
+
+   Write records with OUT (C) from assembly just as well: the id of an
+   event to CDTC_PROBE_EVENT, or the id of a counter to
+   CDTC_PROBE_COUNTER then its value, least significant byte first, to
+   CDTC_PROBE_DATA. */
+
+#define CDTC_PROBE_EVENT 0xFF00
+#define CDTC_PROBE_COUNTER 0xFF01
+#define CDTC_PROBE_DATA 0xFF02
+
+/** Event number ID (0-255) happened now. */
+void cdtc_probe_event (uint8_t id) __z88dk_fastcall __preserves_regs(a, d, e, h, l, iyh, iyl);
+
+/** Counter number ID (0-255) has this value now. */
+void cdtc_probe_counter8 (uint8_t id, uint8_t value) __preserves_regs(d, iyh, iyl);
+void cdtc_probe_counter16 (uint8_t id, uint16_t value) __preserves_regs(d, iyh, iyl);
+void cdtc_probe_counter32 (uint8_t id, uint32_t value) __preserves_regs(d, iyh, iyl);
+
+#endif /* __CDTC_PROBE_H__ */
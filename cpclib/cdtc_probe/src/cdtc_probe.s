@@ -0,0 +1,40 @@
+	.module cdtc_probe
+
+; Records for cdtc_sim --probe, see cdtc_probe.h.  Port &FF00 takes
+; the id of an event, &FF01 the id of a counter, &FF02 each byte of
+; its value.  On a CPC no device answers to these ports.
+
+	.area _CODE
+
+; void cdtc_probe_event (uint8_t id) __z88dk_fastcall;
+_cdtc_probe_event::
+	ld	bc, #0xFF00
+	out	(c), l
+	ret
+
+; void cdtc_probe_counter8 (uint8_t id, uint8_t value);
+; void cdtc_probe_counter16 (uint8_t id, uint16_t value);
+; void cdtc_probe_counter32 (uint8_t id, uint32_t value);
+; E is the size of the value.
+_cdtc_probe_counter32::
+	ld	e, #4
+	jr	counter$
+_cdtc_probe_counter16::
+	ld	e, #2
+	jr	counter$
+_cdtc_probe_counter8::
+	ld	e, #1
+counter$:
+	ld	hl, #2
+	add	hl, sp
+	ld	bc, #0xFF01
+	ld	a, (hl)
+	out	(c), a
+	inc	c
+value$:
+	inc	hl
+	ld	a, (hl)
+	out	(c), a
+	dec	e
+	jr	NZ, value$
+	ret
@@ -0,0 +1,204 @@
+	.module cdtc_turbo_loader
+
+; Turbo tape loader.
+;
+; cdtc_pack --turbo-loader writes this loader on tape as a standard
+; firmware file, fills in cdtc_turbo_load, cdtc_turbo_length and
+; cdtc_turbo_run, then writes the program as one block at a higher
+; speed.  RUN" loads the loader at standard speed, the loader loads the
+; program, then jumps to its run address.
+;
+; The program block: a leader of long periods, one short period as
+; sync, then TAPE_SYNC_BYTE, the program, and a byte that makes the XOR
+; of all bytes zero.  A bit is one period of the tape signal (two pulses
+; of the same length), short for 0, twice as long for 1, most
+; significant bit first.  This is the encoding of the firmware, at any
+; speed: the loader measures the leader to tell short from long.
+;
+; Periods are counted in rounds of the edge$ loop, 12 microseconds
+; each.  Between two bits the loader spends some time away from the
+; loop; where that time is longer than usual (end of byte, between
+; parts of the block) the count of the next bit starts higher to make
+; up for it, see the GAP_ constants.
+
+PPI_PORT_B_HIGH = 0xF5	; in a,(n) reads port A*256+n, &F5xx is PPI port B
+PPI_CONTROL_HIGH = 0xF7
+PPI_MOTOR_ON = 0x09	; set bit 4 of port C
+PPI_MOTOR_OFF = 0x08	; reset bit 4 of port C
+
+TAPE_SYNC_BYTE = 0x16
+LEADER_MIN = 4		; shorter periods are noise, not leader
+
+GAP_SYNC = 1		; rounds lost between sync and the first byte
+GAP_BYTE = 1		; between two bytes
+GAP_DATA = 4		; between the sync byte and the program
+GAP_CHECKSUM = 3	; between the program and the checksum
+
+TXT_OUTPUT = 0xBB5A
+KM_WAIT_CHAR = 0xBB06
+
+	.area _CODE
+
+cdtc_turbo_loader::
+	di
+	ld	bc,#(PPI_CONTROL_HIGH * 256) + PPI_MOTOR_ON
+	out	(c),c
+	ex	af,af'		; the firmware wants AF' back
+	push	af
+	ex	af,af'
+	ld	a,#PPI_PORT_B_HIGH
+	in	a,(0xFF)
+	ld	c,a
+
+	;; Sum the counts of 256 leader periods in HL.
+leader$:
+	ld	hl,#0
+	ld	d,l
+leader_period$:
+	ld	b,#0
+	call	edge$
+	jr	nc,leader$
+	call	edge$
+	jr	nc,leader$
+	ld	a,b
+	cp	#LEADER_MIN
+	jr	c,leader$
+	add	a,l
+	ld	l,a
+	adc	a,h
+	sub	l
+	ld	h,a
+	dec	d
+	jr	nz,leader_period$
+
+	;; Threshold: 3/4 of the average leader period (a 1 bit) is half
+	;; way to a 0 bit.  One less makes up for the time spent outside
+	;; edge$, which counts for a larger part of short periods.
+	ld	a,h
+	srl	a
+	srl	a
+	cpl
+	add	a,h
+	ld	(threshold),a
+	ld	d,a
+	ex	af,af'
+	xor	a
+	ex	af,af'
+
+	;; Wait for the sync, the first short period.
+sync$:
+	ld	b,#0
+	call	edge$
+	jr	nc,leader$
+	call	edge$
+	jr	nc,leader$
+	ld	a,d
+	cp	b
+	jr	c,sync$
+
+	ld	hl,#scratch
+	ld	de,#1
+	ld	b,#GAP_SYNC
+	call	read$
+	jr	nc,leader$
+	ld	a,(scratch)
+	cp	#TAPE_SYNC_BYTE
+	jr	nz,leader$
+
+	ld	hl,(cdtc_turbo_load)
+	ld	de,(cdtc_turbo_length)
+	ld	b,#GAP_DATA
+	call	read$
+	jr	nc,fail$
+	ld	hl,#scratch
+	ld	de,#1
+	ld	b,#GAP_CHECKSUM
+	call	read$
+	jr	nc,fail$
+	ex	af,af'
+	ld	e,a		; XOR of all bytes, zero if good
+	jr	stop$
+fail$:
+	ld	e,#1
+stop$:
+	pop	af
+	ex	af,af'
+	ld	bc,#(PPI_CONTROL_HIGH * 256) + PPI_MOTOR_OFF
+	out	(c),c
+	ei
+	ld	a,e
+	or	a
+	jr	nz,error$
+	ld	hl,(cdtc_turbo_run)
+	jp	(hl)
+
+error$:
+	ld	hl,#message
+print$:
+	ld	a,(hl)
+	inc	hl
+	or	a
+	jr	z,reset$
+	call	TXT_OUTPUT
+	jr	print$
+reset$:
+	call	KM_WAIT_CHAR
+	rst	0x00
+
+; Read DE bytes to HL, most significant bit first, XOR them into A'.
+; B is the starting count of the first bit.  Carry clear on timeout.
+read$:
+	ld	(hl),#1		; shifted out to carry after 8 bits
+bit$:
+	call	edge$
+	ret	nc
+	call	edge$
+	ret	nc
+	ld	a,#0
+threshold = . - 1
+	cp	b		; carry if long, a 1 bit
+	rl	(hl)
+	ld	b,#0
+	jr	nc,bit$
+	ex	af,af'
+	xor	(hl)
+	ex	af,af'
+	inc	hl
+	dec	de
+	ld	a,d
+	or	e
+	ld	b,#GAP_BYTE
+	jr	nz,read$
+	scf
+	ret
+
+; Wait for the next edge of the tape signal, counting rounds in B.  C is
+; the last value read from PPI port B, the tape signal is bit 7.
+; Carry clear on timeout, when B wraps around.
+; Rounds take 12 microseconds: 1+2+2+3+1+3.
+edge$:
+	inc	b
+	ret	z
+	ld	a,#PPI_PORT_B_HIGH
+	in	a,(0xFF)
+	xor	c
+	jp	p,edge$
+	xor	c
+	ld	c,a
+	scf
+	ret
+
+message:
+	.ascii	"Load error, press any key"
+	.db	13, 10, 0
+
+scratch:
+	.db	0
+
+; Filled in by cdtc_pack.
+cdtc_turbo_load::
+	.dw	0
+cdtc_turbo_length::
+	.dw	0
+cdtc_turbo_run::
+	.dw	0
@@ -0,0 +1,19 @@
+#include "banks.h"
+
+/* Only seen while bank 4 is mapped, from the code of bank 4. */
+static const uint8_t primes[4] = { 3, 5, 7, 11 };
+static uint8_t factor = 10;
+
+uint8_t
+bank4_inner (uint8_t i)
+{
+	return primes[i];
+}
+
+/* Bank 4 calls bank 5, which calls back into bank 4: once both return,
+   factor must be read from bank 4 again. */
+uint16_t
+bank4_outer (uint8_t i)
+{
+	return bank5_middle (i) * factor;
+}
@@ -0,0 +1,14 @@
+#include "banks.h"
+
+/* Only seen while bank 5 is mapped, from the code of bank 5. */
+static uint8_t offset = 100;
+
+/* Calls bank 4 and the main program: offset must be read from bank 5
+   once bank 4 returns. */
+uint16_t
+bank5_middle (uint8_t i)
+{
+	uint8_t prime = bank4_inner (i);
+
+	return prime + offset + main_twice (i);
+}
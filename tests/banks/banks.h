@@ -0,0 +1,16 @@
+#ifndef __BANKS_H__
+#define __BANKS_H__
+
+#include <stdint.h>
+
+/* bank4.c, in bank 4. */
+uint8_t bank4_inner (uint8_t i);
+uint16_t bank4_outer (uint8_t i);
+
+/* bank5.c, in bank 5. */
+uint16_t bank5_middle (uint8_t i);
+
+/* main.c, in main RAM. */
+uint8_t main_twice (uint8_t i);
+
+#endif /* __BANKS_H__ */
@@ -0,0 +1,43 @@
+#include <stdint.h>
+#include "cfwi/cfwi.h"
+#include "banks.h"
+
+/* Run from the disc with RUN"banks: the BASIC loader banks.BAS loads
+   banks.B4 and banks.B5 in banks 4 and 5, then runs banks.BIN.  Calls
+   go through the trampolines, nested up to main -> bank 4 -> bank 5 ->
+   bank 4, and each return must map back the bank of its caller. */
+
+uint8_t
+main_twice (uint8_t i)
+{
+	return i * 2;
+}
+
+/* Main RAM in the window, that a bank left mapped would hide. */
+#define WINDOW_LAST ((volatile uint8_t *) 0x7FFF)
+
+void
+main ()
+{
+	uint8_t ok = 1;
+
+	*WINDOW_LAST = 0x5a;
+	/* primes[2] = 7, then 7 + 100 + 2 * 2 = 111, then 111 * 10. */
+	ok &= (bank4_inner (2) == 7);
+	ok &= (bank5_middle (2) == 111);
+	ok &= (bank4_outer (2) == 1110);
+	ok &= (*WINDOW_LAST == 0x5a);
+
+	if (ok)
+	{
+		fw_mc_send_printer('O');
+		fw_mc_send_printer('K');
+	}
+	else
+	{
+		fw_mc_send_printer('K');
+		fw_mc_send_printer('O');
+	}
+	fw_mc_send_printer('\n');
+	fw_mc_wait_flyback();
+}
@@ -0,0 +1,37 @@
+#include <stdint.h>
+#include <cdtc_bench.h>
+
+/* Regions for "make bench-cycles", checked by local.Makefile: region 1
+   runs once, region 2 four times inside it, and region 3 is three NOPs
+   exactly, since the markers themselves do not count. */
+
+static volatile uint8_t sum;
+
+void
+bench ()
+{
+	uint8_t i;
+
+	cdtc_bench_begin (1);
+	for (i = 0; i < 4; i++)
+	{
+		cdtc_bench_begin (2);
+		sum += i;
+		cdtc_bench_end ();
+	}
+	cdtc_bench_end ();
+
+	cdtc_bench_begin (3);
+	__asm
+	nop
+	nop
+	nop
+	__endasm;
+	cdtc_bench_end ();
+}
+
+void
+main ()
+{
+	bench ();
+}
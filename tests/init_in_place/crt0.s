@@ -0,0 +1,152 @@
+	;; crt0.s - A crt0 in Z80 assembler language targeting Amstrad CPC
+
+	;; Copyright (C) 2013 Stéphane Gourichon / cpcitor
+
+	;  This library is free software; you can redistribute it and/or modify it
+	;  under the terms of the GNU General Public License as published by the
+	;  Free Software Foundation; either version 2, or (at your option) any
+	;  later version.
+	;
+	;  This library is distributed in the hope that it will be useful,
+	;  but WITHOUT ANY WARRANTY; without even the implied warranty of
+	;  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	;  GNU General Public License for more details.
+	;
+	;  You should have received a copy of the GNU General Public License
+	;  along with this library; see the file COPYING. If not, write to the
+	;  Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+	;   MA 02110-1301, USA.
+	;
+	;  As a special exception, if you link this library with other files,
+	;  some of which are compiled with SDCC, to produce an executable,
+	;  this library does not by itself cause the resulting executable to
+	;  be covered by the GNU General Public License. This exception does
+	;  not however invalidate any other reasons why the executable file
+	;   might be covered by the GNU General Public License.
+	;--------------------------------------------------------------------------
+
+	;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+	;; Since this will be used by CPC coders, which are usually
+	;; not savvy of C compiling/linking/init internals, this file
+	;; is abundantly commented.
+	;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+
+	;; The module name appears in many compiler/linker log files,
+	;; so it's important to define it.
+
+	.module crt0
+
+
+	;; We will reference the C-level symbol "main".
+	;; The line below is equivalent to C-level "extern void main();"
+
+	.globl _main
+
+
+
+	;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+	;; Do we need an absolutely positioned HEADER area ?
+	;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+
+	;; Short answer: no for a RAM program.
+
+	;; Most z80 crt0 start with dedicating 0x38 bytes to interrupt
+        ;; vectors. This makes sense only when making an image that
+        ;; starts at address 0, which is not the case for a CPC RAM
+        ;; program or upper ROM program.
+	;; This crt0 targets a RAM program. So nothing to do at this step.
+
+
+	;; Creating absolutely positioned linker areas would just put
+	;; constraints and yield more maintenance work.
+
+	;; We can avoid that and just let the linker pack areas one
+	;; after the other.  So, no ".org 0x" here. The simplest thing
+	;; to do with SDCC's Z80 target is to set location at only one
+	;; place : the --code-loc option of sdcc.
+
+	;; Hence, we start with the CODE area to ensure we start at
+	;; the requested location.
+
+	.area	_CODE
+
+cpc_run_address::
+init:
+        ;; Initialise global variables, see below.
+        call    gsinit
+	jp	_main
+
+	;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+	;; Do we need an _exit symbol ?
+	;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+
+	;; Short answer: not confirmed, so not done.
+
+	;; SDCC's default crt0 defines a _exit symbol that does "ld a,#0 ; rst 0x08".
+	;; This is supposed to allow the C-level exit() function to do what people expect.
+	;; This won't work on the CPC.
+
+	;; We have three choices :
+
+	;; - just don't implement exit()
+
+	;; - implement it with a "ret". This would enable calling
+	;; "exit(value);" form main(). It has limited interest because
+	;; "return value;" already works (FIXME check which register
+	;; holds return value). Unfortunately, from another C function
+	;; it would just return from the current function, not exit
+	;; the program. So, not really useful.
+
+	;; - implement it with "rst 0x00". This should reset the CPC.
+
+	;; - record stack pointer before calling _main, put it back on
+	;; _exit, set the return value in register and "ret". That
+	;; would work if the C code has not killed the firmware RAM
+	;; area.
+
+	;; That last option would be useful especially when using
+	;; cpc-dev-tool-chain to implement some RSX extensions that
+	;; need to call exit().
+
+	;; Until the need is confirmed we do nothing.
+
+
+
+	;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+	;; Initialize global variables: nothing to copy.
+	;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+
+	;; This crt0 is the variant for CDTC_INIT_IN_PLACE=1 (see
+	;; sdcc-project.Makefile).
+
+	;; SDCC puts initialized global variables in area
+	;; _INITIALIZED, and their initial values in area
+	;; _INITIALIZER.  The usual crt0 copies _INITIALIZER to
+	;; _INITIALIZED, which for a RAM program wastes as many bytes
+	;; as there is initialized data, plus the time of the copy.
+
+	;; With CDTC_INIT_IN_PLACE=1 the program is linked a second
+	;; time with _INITIALIZED at the address of _INITIALIZER.
+	;; Loading the program from disc or tape is then what
+	;; initializes variables: no copy, no wasted byte.
+
+	;; Consequence: variables are not reset if the program is run
+	;; again from memory, e.g. CALL &4000 after it returned.
+	;; Reload it instead.
+
+	;; gsinit stays, because SDCC may add code to area _GSINIT,
+	;; ended by the "ret" in _GSFINAL.
+
+	.area   _GSINIT
+
+gsinit::
+
+	.area   _GSFINAL
+	ret
+
+	.area   _DATA
+	.area 	_HOME
+	.area   _INITIALIZER
+	.area   _INITIALIZED
+	.area	_AFTERCODE
+_aftercode::
@@ -0,0 +1,75 @@
+#include <stdint.h>
+#include "cfwi/cfwi.h"
+
+/* Initialized global variables of several kinds.  With
+   CDTC_INIT_IN_PLACE=1 they hold their values as soon as the program is
+   loaded, crt0 copies nothing. */
+
+struct point
+{
+	int8_t x;
+	int16_t y;
+};
+
+uint8_t u8 = 0xa5;
+int16_t s16 = -12345;
+uint32_t u32 = 0xdeadbeefUL;
+static uint16_t static_u16 = 6128;
+char text[] = "cpc-dev-tool-chain";
+struct point points[3] = { { 1, 1000 }, { -2, -2000 }, { 3, 3000 } };
+uint8_t *pointer = &u8;
+const char *string = "initialized in place";
+
+/* Number of variables that do not have their initial value.  Called
+   right after loading by the cdtc_sim check of local.Makefile. */
+uint16_t
+init_in_place_wrong ()
+{
+	static const char expected_text[] = "cpc-dev-tool-chain";
+	static const char expected_string[] = "initialized in place";
+	uint16_t wrong = 0;
+	uint8_t i;
+
+	wrong += (u8 != 0xa5);
+	wrong += (s16 != -12345);
+	wrong += (u32 != 0xdeadbeefUL);
+	wrong += (static_u16 != 6128);
+	for (i = 0; i < sizeof (text); i++)
+	{
+		wrong += (text[i] != expected_text[i]);
+	}
+	for (i = 0; i < 3; i++)
+	{
+		wrong += (points[i].x != (i & 1 ? -(i + 1) : i + 1));
+		wrong += (points[i].y != (i & 1 ? -1000 * (i + 1) : 1000 * (i + 1)));
+	}
+	wrong += (pointer != &u8);
+	for (i = 0; i < sizeof (expected_string); i++)
+	{
+		wrong += (string[i] != expected_string[i]);
+	}
+	return wrong;
+}
+
+void
+main ()
+{
+	uint16_t wrong = init_in_place_wrong ();
+
+	/* Variables stay writable. */
+	u8++;
+	points[1].y += 2000;
+
+	if (wrong == 0 && u8 == 0xa6 && points[1].y == 0)
+	{
+		fw_mc_send_printer('O');
+		fw_mc_send_printer('K');
+	}
+	else
+	{
+		fw_mc_send_printer('K');
+		fw_mc_send_printer('O');
+	}
+	fw_mc_send_printer('\n');
+	fw_mc_wait_flyback();
+}
@@ -0,0 +1,48 @@
+#include <stdint.h>
+
+/* With CDTC_LINK_GC=1 each function of this file is a module of its
+   own: unused_function() is left out of the link although main() and
+   used_function() are in the same file. */
+
+static uint8_t calls;
+
+/* Static: used from two functions, so made global and renamed when the
+   file is split. */
+static uint16_t
+sum_of (const char *s)
+{
+	uint16_t sum = 0;
+
+	calls++;
+	while (*s)
+		sum += (uint8_t) *s++;
+	return sum;
+}
+
+/* 'a' + 'b' + 'c' = 294. */
+uint16_t
+used_function ()
+{
+	return sum_of ("abc");
+}
+
+uint16_t
+unused_function ()
+{
+	return sum_of ("this string is never linked") * 3;
+}
+
+/* 295 if used_function() worked and called sum_of() once.  Called
+   right after loading by the cdtc_sim check of local.Makefile. */
+uint16_t
+link_gc_check ()
+{
+	calls = 0;
+	return used_function () + calls;
+}
+
+void
+main ()
+{
+	link_gc_check ();
+}
@@ -0,0 +1,10 @@
+	.module bits
+
+; A hand-written table in area _ALIGNED256, next to the aligned tables
+; of lookup.tables: the link starts each module's part of the area at
+; a multiple of 256.
+
+	.area _ALIGNED256
+
+_bits::
+	.db	0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80
@@ -0,0 +1,67 @@
+#include <stdint.h>
+#include "cfwi/cfwi.h"
+#include "lookup.tables.h"
+
+/* In bits.s. */
+extern const uint8_t bits[8];
+
+/* Tables generated at build time from lookup.tables, and one written
+   in bits.s.  Each is compared with what the program computes itself,
+   except the sine, which the program cannot compute: its symmetries
+   and a few known values are checked instead. */
+
+/* Number of wrong elements or misaligned tables.  Called right after
+   loading by the cdtc_sim check of local.Makefile. */
+uint16_t
+lookup_tables_wrong ()
+{
+	uint16_t wrong = 0;
+	uint16_t i;
+
+	for (i = 0; i < 512; i++)
+	{
+		wrong += (squares_div4[i] != (uint16_t) ((uint32_t) i * i / 4));
+	}
+	for (i = 0; i < 200; i++)
+	{
+		wrong += (screen_lines[i] != 0xC000 + i / 8 * 80 + i % 8 * 0x800);
+	}
+	for (i = 0; i < 4; i++)
+	{
+		wrong += (pixel_masks[i] != (0x88 >> i));
+	}
+	wrong += (sine[0] != 0 || sine[64] != 127 || sine[128] != 0 || sine[192] != -127);
+	for (i = 1; i < 128; i++)
+	{
+		wrong += (sine[i] != -sine[256 - i]);
+	}
+	for (i = 0; i < 64; i++)
+	{
+		wrong += (sine[i] != sine[128 - i]);
+	}
+	wrong += (((uint16_t) squares_div4 & 0xFF) != 0);
+	wrong += (((uint16_t) sine & 0xFF) != 0);
+	for (i = 0; i < 8; i++)
+	{
+		wrong += (bits[i] != 1 << i);
+	}
+	wrong += (((uint16_t) bits & 0xFF) != 0);
+	return wrong;
+}
+
+void
+main ()
+{
+	if (lookup_tables_wrong () == 0)
+	{
+		fw_mc_send_printer('O');
+		fw_mc_send_printer('K');
+	}
+	else
+	{
+		fw_mc_send_printer('K');
+		fw_mc_send_printer('O');
+	}
+	fw_mc_send_printer('\n');
+	fw_mc_wait_flyback();
+}
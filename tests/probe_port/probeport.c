@@ -0,0 +1,27 @@
+#include <stdint.h>
+#include <cdtc_probe.h>
+
+/* Records for "make probe", checked by local.Makefile: an event, a
+   counter of each size, then another event. */
+
+static uint8_t table[16];
+
+void
+probe ()
+{
+	uint8_t i;
+
+	cdtc_probe_event (1);
+	for (i = 0; i < 16; i++)
+		table[i] = i * 3;
+	cdtc_probe_counter8 (2, table[15]);
+	cdtc_probe_counter16 (3, 0x1234);
+	cdtc_probe_counter32 (4, 0x12345678);
+	cdtc_probe_event (5);
+}
+
+void
+main ()
+{
+	probe ();
+}
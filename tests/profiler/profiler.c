@@ -0,0 +1,38 @@
+#include <stdint.h>
+
+/* A known profile for "make profile", checked by local.Makefile: hot()
+   loops 100 times longer than cold(), which runs twice. */
+
+static volatile uint16_t sink;
+
+void
+cold ()
+{
+	uint8_t i;
+
+	for (i = 0; i < 20; i++)
+		sink += i;
+}
+
+void
+hot ()
+{
+	uint16_t i;
+
+	for (i = 0; i < 2000; i++)
+		sink += i;
+}
+
+void
+profile ()
+{
+	cold ();
+	hot ();
+	cold ();
+}
+
+void
+main ()
+{
+	profile ();
+}
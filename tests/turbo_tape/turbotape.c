@@ -0,0 +1,41 @@
+#include <stdint.h>
+#include "cfwi/cfwi.h"
+
+/* 8K of data, so that tape speeds make a difference.  Every byte is a
+   function of its index, checked once loaded. */
+#define BYTE(i) ((uint8_t) ((i) * 73u + ((i) >> 8)))
+#define B4(i) BYTE (i), BYTE (i + 1), BYTE (i + 2), BYTE (i + 3)
+#define B16(i) B4 (i), B4 (i + 4), B4 (i + 8), B4 (i + 12)
+#define B64(i) B16 (i), B16 (i + 16), B16 (i + 32), B16 (i + 48)
+#define B256(i) B64 (i), B64 (i + 64), B64 (i + 128), B64 (i + 192)
+#define B1K(i) B256 (i), B256 (i + 256), B256 (i + 512), B256 (i + 768)
+#define B4K(i) B1K (i), B1K (i + 1024), B1K (i + 2048), B1K (i + 3072)
+
+const uint8_t table[8192] = { B4K (0u), B4K (4096u) };
+
+void
+main ()
+{
+	uint16_t i, bad = 0;
+
+	for (i = 0; i < sizeof (table); i++)
+	{
+		if (table[i] != BYTE (i))
+		{
+			bad++;
+		}
+	}
+
+	if (bad == 0)
+	{
+		fw_mc_send_printer('O');
+		fw_mc_send_printer('K');
+	}
+	else
+	{
+		fw_mc_send_printer('K');
+		fw_mc_send_printer('O');
+	}
+	fw_mc_send_printer('\n');
+	fw_mc_wait_flyback();
+}
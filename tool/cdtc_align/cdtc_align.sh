@@ -0,0 +1,177 @@
+#!/bin/bash
+
+# Place area _ALIGNED256 on 256-byte boundaries at link time.
+#
+# Usage:
+#   cdtc_align.sh order WORKDIR REPORT RELS...
+#   cdtc_align.sh place MAP CODELOC REPORT
+#   cdtc_align.sh check MAP REPORT
+#
+# Each module (.rel file) that has bytes in area _ALIGNED256 gets them
+# at an address multiple of 256, e.g. for a table indexed with
+# "ld h, #>table" and "ld l, a".
+#
+# "order" prints RELS again, with the modules that have an _ALIGNED256
+# area moved to the end, each but the last followed by a module that
+# only pads the area to the next multiple of 256.  These padding modules
+# are assembled in WORKDIR, sdasz80 must be in the PATH.  The module
+# that needs the most padding goes last, where it needs none.  REPORT
+# gets one line per module.  If no module has an _ALIGNED256 area,
+# RELS are printed unchanged and REPORT is removed.
+#
+# "place" reads the map of a first link of these modules and prints
+# the flags of sdcc for a second one, where the area starts at a
+# multiple of 256.  Either the area goes first, at CODELOC rounded up,
+# and code follows it, or it goes after all loaded areas, before
+# _DATA, which then follows it.  The way that loses fewer bytes wins.
+#
+# "check" tells whether the area starts at a multiple of 256 in the
+# map of the final link, and has the size REPORT expects.  It exits 1
+# if not.
+
+set -eu -o pipefail
+
+function usage()
+{
+    echo >&2 "Usage: $0 order WORKDIR REPORT RELS..."
+    echo >&2 "       $0 place MAP CODELOC REPORT"
+    echo >&2 "       $0 check MAP REPORT"
+    exit 2
+}
+
+# Size of area _ALIGNED256 in a .rel file, 0 if it has none.
+function area_size()
+{
+    awk '
+NR == 1 { radix = substr($0, 1, 1) == "D" ? 10 : substr($0, 1, 1) == "Q" ? 8 : 16 }
+$1 == "A" && $2 == "_ALIGNED256" {
+    n = 0
+    s = toupper($4)
+    for (i = 1; i <= length(s); i++)
+        n = n * radix + index("0123456789ABCDEF", substr(s, i, 1)) - 1
+    size += n
+}
+END { print size + 0 }
+' "$1"
+}
+
+# Value of a symbol of the map, in decimal, empty if not found.
+function symbol()
+{
+    local VALUE
+    VALUE=$( awk -v name="$2" '$2 == name { print substr($1, 5) ; exit }' "$1" )
+    [[ -z "$VALUE" ]] || echo $(( 16#$VALUE ))
+}
+
+[[ $# -ge 1 ]] || usage
+COMMAND="$1"
+shift
+
+case "$COMMAND" in
+    order)
+        [[ $# -ge 2 ]] || usage
+        WORKDIR="$1"
+        REPORT="$2"
+        shift 2
+        OTHERS=()
+        ALIGNED=()
+        SIZES=()
+        LAST=-1
+        for REL in "$@"
+        do
+            SIZE=$( area_size "$REL" )
+            if [[ $SIZE -eq 0 ]]
+            then
+                OTHERS+=("$REL")
+                continue
+            fi
+            ALIGNED+=("$REL")
+            SIZES+=("$SIZE")
+            if [[ $LAST -lt 0 ]] || (( (-SIZE & 255) > (-SIZES[LAST] & 255) ))
+            then LAST=$(( ${#ALIGNED[@]} - 1 ))
+            fi
+        done
+        if [[ ${#ALIGNED[@]} -eq 0 ]]
+        then
+            rm -f "$REPORT"
+            echo "$@"
+            exit 0
+        fi
+        mkdir -p "$WORKDIR"
+        rm -f "$WORKDIR"/cdtc_align_pad_*
+        RELS=("${OTHERS[@]+"${OTHERS[@]}"}")
+        PADDING=0
+        # Appends module $1 to RELS, then padding for $2 bytes.
+        function append()
+        {
+            local I="$1" PAD="$2" PAD_S
+            RELS+=("${ALIGNED[I]}")
+            printf "%-32s %8d %8d\n" "$( basename "${ALIGNED[I]}" .rel )" "${SIZES[I]}" "$PAD"
+            [[ $PAD -gt 0 ]] || return 0
+            PAD_S="$WORKDIR/cdtc_align_pad_$I.s"
+            printf "\t.module cdtc_align_pad_%d\n\t.area _ALIGNED256\n\t.ds %d\n" "$I" "$PAD" >"$PAD_S"
+            sdasz80 -o "${PAD_S%.s}.rel" "$PAD_S" >&2
+            RELS+=("${PAD_S%.s}.rel")
+            PADDING=$(( PADDING + PAD ))
+        }
+        {
+            printf "%-32s %8s %8s\n" module bytes padding
+            for I in "${!ALIGNED[@]}"
+            do
+                [[ $I -eq $LAST ]] || append "$I" $(( -SIZES[I] & 255 ))
+            done
+            append "$LAST" 0
+            echo "between modules: $PADDING bytes of padding"
+        } >"$REPORT.tmp"
+        mv -f "$REPORT.tmp" "$REPORT"
+        echo "${RELS[@]}"
+        ;;
+
+    place)
+        [[ $# -eq 3 ]] || usage
+        MAP="$1"
+        CODELOC=$(( $2 ))
+        REPORT="$3"
+        SIZE=$( symbol "$MAP" l__ALIGNED256 )
+        DATA=$( symbol "$MAP" s__DATA )
+        if [[ -z "$SIZE" || -z "$DATA" ]]
+        then
+            echo >&2 "$0: no l__ALIGNED256 or s__DATA in $MAP"
+            exit 1
+        fi
+        FIRST=$(( (CODELOC + 255) & ~255 ))
+        LAST=$(( (DATA + 255) & ~255 ))
+        if (( FIRST - CODELOC <= LAST - DATA ))
+        then
+            printf -- "--code-loc 0x%04x --data-loc 0 -Wl-b_ALIGNED256=0x%04x\n" $(( FIRST + SIZE )) $FIRST
+            printf "area _ALIGNED256 first, at &%04X: %d bytes lost before it\n" $FIRST $(( FIRST - CODELOC )) >>"$REPORT"
+        else
+            printf -- "--code-loc 0x%04x --data-loc 0 -Wl-b_ALIGNED256=0x%04x -Wl-b_DATA=0x%04x\n" $CODELOC $LAST $(( LAST + SIZE ))
+            printf "area _ALIGNED256 last, at &%04X: %d bytes lost before it\n" $LAST $(( LAST - DATA )) >>"$REPORT"
+        fi
+        ;;
+
+    check)
+        [[ $# -eq 2 ]] || usage
+        MAP="$1"
+        REPORT="$2"
+        START=$( symbol "$MAP" s__ALIGNED256 )
+        SIZE=$( symbol "$MAP" l__ALIGNED256 )
+        EXPECTED=$( awk 'NR > 1 && NF == 3 { total += $2 + $3 } END { print total + 0 }' "$REPORT" )
+        if [[ -z "$START" ]] || (( START & 255 ))
+        then
+            echo >&2 "$0: area _ALIGNED256 is not at a multiple of 256 in $MAP"
+            exit 1
+        fi
+        if [[ "$SIZE" != "$EXPECTED" ]]
+        then
+            echo >&2 "$0: area _ALIGNED256 is $SIZE bytes in $MAP instead of $EXPECTED, is a library module using it?"
+            exit 1
+        fi
+        awk '/bytes of padding$/ { pad += $3 } /bytes lost before it$/ { pad += $(NF - 4) } END { print "total: " pad " bytes lost to alignment" }' "$REPORT" >>"$REPORT"
+        ;;
+
+    *)
+        usage
+        ;;
+esac
@@ -0,0 +1,459 @@
+/*
+ * cdtc_asmsym: export constants of an assembler module to C.
+ *
+ * Reads the symbol table of the relocatable file that sdasz80 made from
+ * source.s, keeps the symbols that source.s defines with "==" (global
+ * constants), and writes a C header with one #define ASMCONST_<name>
+ * per symbol.  One pass over each file, whatever the number of symbols.
+ *
+ *   cdtc_asmsym [--areas] source.s source.rel output.h
+ *
+ * With --areas the header also gets, for each area of the module that
+ * is not empty, ASMAREA_<area>_SIZE, and ASMAREA_<area>_BNDRY for areas
+ * that source.s aligns with .bndry.
+ *
+ * The header is rewritten only when its content changes, so that C files
+ * that include it are not recompiled after each assembly.  When there is
+ * nothing to export, no header is written (and a former one is removed).
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <getopt.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LINE 4096
+
+static const char *progname = "cdtc_asmsym";
+
+static void
+die (const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start (ap, fmt);
+	fprintf (stderr, "%s: ", progname);
+	vfprintf (stderr, fmt, ap);
+	fputc ('\n', stderr);
+	va_end (ap);
+	exit (1);
+}
+
+static void *
+xmalloc (size_t size)
+{
+	void *p = malloc (size);
+
+	if (p == NULL)
+		die ("out of memory");
+	return p;
+}
+
+static char *
+xstrndup (const char *s, size_t length)
+{
+	char *p = xmalloc (length + 1);
+
+	memcpy (p, s, length);
+	p[length] = '\0';
+	return p;
+}
+
+/************************************************************************
+ * Names defined with "==" in the source, in a hash set
+ ************************************************************************/
+
+struct name_set
+{
+	char **slots;
+	unsigned int size;	/* power of two */
+	unsigned int count;
+};
+
+static unsigned int
+hash_name (const char *s, size_t length)
+{
+	unsigned int h = 2166136261u;
+
+	while (length-- > 0)
+		h = (h ^ (unsigned char) *s++) * 16777619u;
+	return h;
+}
+
+static void name_set_add (struct name_set *set, const char *s, size_t length);
+
+static void
+name_set_grow (struct name_set *set)
+{
+	struct name_set bigger;
+	unsigned int i;
+
+	bigger.size = set->size ? set->size * 2 : 1024;
+	bigger.count = 0;
+	bigger.slots = xmalloc (bigger.size * sizeof *bigger.slots);
+	memset (bigger.slots, 0, bigger.size * sizeof *bigger.slots);
+	for (i = 0; i < set->size; i++)
+		if (set->slots[i] != NULL)
+		{
+			name_set_add (&bigger, set->slots[i], strlen (set->slots[i]));
+			free (set->slots[i]);
+		}
+	free (set->slots);
+	*set = bigger;
+}
+
+static char **
+name_set_slot (const struct name_set *set, const char *s, size_t length)
+{
+	unsigned int i = hash_name (s, length) & (set->size - 1);
+
+	while (set->slots[i] != NULL
+	       && (strlen (set->slots[i]) != length
+		   || memcmp (set->slots[i], s, length) != 0))
+		i = (i + 1) & (set->size - 1);
+	return &set->slots[i];
+}
+
+static void
+name_set_add (struct name_set *set, const char *s, size_t length)
+{
+	char **slot;
+
+	if (set->count * 2 >= set->size)
+		name_set_grow (set);
+	slot = name_set_slot (set, s, length);
+	if (*slot == NULL)
+	{
+		*slot = xstrndup (s, length);
+		set->count++;
+	}
+}
+
+static int
+name_set_has (const struct name_set *set, const char *s, size_t length)
+{
+	return set->size != 0 && *name_set_slot (set, s, length) != NULL;
+}
+
+/************************************************************************
+ * Output text
+ ************************************************************************/
+
+struct text
+{
+	char *data;
+	size_t length, allocated;
+};
+
+static void
+text_printf (struct text *t, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	for (;;)
+	{
+		va_start (ap, fmt);
+		n = vsnprintf (t->data + t->length, t->allocated - t->length,
+			       fmt, ap);
+		va_end (ap);
+		if (n < 0)
+			die ("cannot format output");
+		if (t->length + n < t->allocated)
+			break;
+		t->allocated = (t->length + n + 1) * 2;
+		t->data = realloc (t->data, t->allocated);
+		if (t->data == NULL)
+			die ("out of memory");
+	}
+	t->length += n;
+}
+
+/* Keep the old file, and its time, when the content is the same. */
+static void
+write_if_changed (const char *filename, const struct text *t)
+{
+	FILE *f = fopen (filename, "rb");
+	char *tmpname;
+
+	if (f != NULL)
+	{
+		char *old = xmalloc (t->length + 1);
+		size_t got = fread (old, 1, t->length + 1, f);
+		int same = got == t->length && memcmp (old, t->data, got) == 0;
+
+		fclose (f);
+		free (old);
+		if (same)
+			return;
+	}
+
+	tmpname = xmalloc (strlen (filename) + 5);
+	sprintf (tmpname, "%s.tmp", filename);
+	f = fopen (tmpname, "wb");
+	if (f == NULL)
+		die ("%s: %s", tmpname, strerror (errno));
+	if (fwrite (t->data, 1, t->length, f) != t->length || fclose (f) != 0)
+		die ("%s: %s", tmpname, strerror (errno));
+	if (rename (tmpname, filename) != 0)
+		die ("%s: %s", filename, strerror (errno));
+	free (tmpname);
+}
+
+/************************************************************************
+ * Source and relocatable file
+ ************************************************************************/
+
+#define MAX_AREAS 64
+
+struct area
+{
+	char *name;
+	unsigned long size;
+	unsigned long bndry;
+};
+
+struct module
+{
+	struct name_set constants;
+	struct area areas[MAX_AREAS];
+	unsigned int area_count;
+};
+
+static int
+is_symbol_char (int c)
+{
+	return isalnum (c) || c == '_' || c == '.' || c == '$';
+}
+
+static struct area *
+find_area (struct module *m, const char *name, size_t length)
+{
+	unsigned int i;
+
+	for (i = 0; i < m->area_count; i++)
+		if (strlen (m->areas[i].name) == length
+		    && memcmp (m->areas[i].name, name, length) == 0)
+			return &m->areas[i];
+	if (m->area_count == MAX_AREAS)
+		die ("more than %d areas", MAX_AREAS);
+	m->areas[m->area_count].name = xstrndup (name, length);
+	m->areas[m->area_count].size = 0;
+	m->areas[m->area_count].bndry = 0;
+	return &m->areas[m->area_count++];
+}
+
+/* Lines "name == value", and the .bndry of each .area. */
+static void
+read_source (const char *filename, struct module *m)
+{
+	FILE *f = fopen (filename, "r");
+	char line[MAX_LINE];
+	struct area *area = find_area (m, "_CODE", 5);
+
+	if (f == NULL)
+		die ("%s: %s", filename, strerror (errno));
+	while (fgets (line, sizeof line, f) != NULL)
+	{
+		const char *p = line, *name;
+		size_t length;
+
+		while (*p == ' ' || *p == '\t')
+			p++;
+		name = p;
+		while (is_symbol_char (*p))
+			p++;
+		length = p - name;
+		while (*p == ' ' || *p == '\t')
+			p++;
+		if (length == 0)
+			continue;
+		if (p[0] == '=' && p[1] == '=')
+			name_set_add (&m->constants, name, length);
+		else if (length == 5 && strncmp (name, ".area", 5) == 0)
+		{
+			name = p;
+			while (is_symbol_char (*p))
+				p++;
+			if (p != name)
+				area = find_area (m, name, p - name);
+		}
+		else if (length == 6 && strncmp (name, ".bndry", 6) == 0)
+		{
+			unsigned long bndry = strtoul (p, NULL, 0);
+
+			if (bndry > area->bndry)
+				area->bndry = bndry;
+		}
+	}
+	if (ferror (f))
+		die ("%s: %s", filename, strerror (errno));
+	fclose (f);
+}
+
+static void
+put_define (struct text *t, const char *prefix, const char *name,
+	    const char *suffix, const char *value)
+{
+	text_printf (t, "#define %s", prefix);
+	for (; *name != '\0'; name++)
+		text_printf (t, "%c", isalnum ((unsigned char) *name) ? *name : '_');
+	text_printf (t, "%s %s\n", suffix, value);
+}
+
+/* "S name Def1234" lines give the value of each symbol, "A name size
+ * 12 ..." lines the size of each area. */
+static unsigned int
+read_rel (const char *filename, struct module *m, int want_areas,
+	  struct text *t)
+{
+	FILE *f = fopen (filename, "r");
+	char line[MAX_LINE];
+	unsigned int defines = 0;
+
+	if (f == NULL)
+		die ("%s: %s", filename, strerror (errno));
+	while (fgets (line, sizeof line, f) != NULL)
+	{
+		char name[MAX_LINE], value[MAX_LINE];
+		unsigned long size;
+		int end = 0;
+
+		if (sscanf (line, "S %s Def%4[0-9A-F]%n", name, value, &end) == 2
+		    && strlen (value) == 4
+		    && (line[end] == '\n' || line[end] == '\0')
+		    && name[0] != '.'
+		    && name_set_has (&m->constants, name, strlen (name)))
+		{
+			char hex[8];
+
+			sprintf (hex, "0x%s", value);
+			put_define (t, "ASMCONST_", name, "", hex);
+			defines++;
+		}
+		else if (want_areas
+			 && sscanf (line, "A %s size %lx", name, &size) == 2
+			 && size != 0)
+			find_area (m, name, strlen (name))->size = size;
+	}
+	if (ferror (f))
+		die ("%s: %s", filename, strerror (errno));
+	fclose (f);
+
+	if (want_areas)
+	{
+		unsigned int i;
+
+		for (i = 0; i < m->area_count; i++)
+		{
+			char number[32];
+
+			if (m->areas[i].size == 0)
+				continue;
+			sprintf (number, "0x%04lX", m->areas[i].size);
+			put_define (t, "ASMAREA_", m->areas[i].name, "_SIZE", number);
+			defines++;
+			if (m->areas[i].bndry > 1)
+			{
+				sprintf (number, "%lu", m->areas[i].bndry);
+				put_define (t, "ASMAREA_", m->areas[i].name, "_BNDRY", number);
+			}
+		}
+	}
+	return defines;
+}
+
+static void
+put_preamble (struct text *t, const char *source, const char *rel,
+	      const char *output)
+{
+	text_printf (t,
+		     "#include <stdint.h>\n"
+		     "\n"
+		     "// This file is generated from assembler's relocatable output:\n"
+		     "// %s\n"
+		     "\n"
+		     "// As you may know, in assembly source code you can:\n"
+		     "// (1) define named constants,\n"
+		     "// (2) even when defined in reference to other constants,\n"
+		     "// (3) use them as parameters to macro calls,\n"
+		     "// (4) export them to C as... ahem, void pointers, not true constants.\n"
+		     "\n"
+		     "// This file generated by cpc-dev-tool-chain allows you, \n"
+		     "// *without any cost on the target*, to get\n"
+		     "// C-level #define constants *guaranteed to be in sync with ASM*, \n"
+		     "// will full compile-time optimization and tricks available.\n"
+		     "\n"
+		     "// Basically, ASM side do this:\n"
+		     "// my_variable == ( 42 >> 2 ) / 3\n"
+		     "// my_other_variable == ( my_variable + 6128 ) / 464\n"
+		     "// And in you C source file do this:\n"
+		     "// #include \"%s\"\n"
+		     "// Your C code can then do:\n"
+		     "// uint8_t table[ASMCONST_my_variable][ASMCONST_my_other_variable];\n"
+		     "\n"
+		     "// Notice, we only generate #define here because they consume no target memory compiler would allocate \n"
+		     "// Notice, typed variables would have consumed target memory, would not have been good.\n"
+		     "\n"
+		     "// DO NOT EDIT this file. Instead, edit upstream source of truth: \n"
+		     "// %s\n"
+		     "\n",
+		     rel, output, source);
+}
+
+static void
+usage (FILE *f)
+{
+	fprintf (f,
+		 "Usage: %s [options] source.s source.rel output.h\n"
+		 "  -a, --areas   also export the size (and .bndry alignment) of each area\n"
+		 "  -h, --help\n",
+		 progname);
+}
+
+int
+main (int argc, char **argv)
+{
+	static const struct option options[] = {
+		{"areas", no_argument, NULL, 'a'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0}
+	};
+	int opt, want_areas = 0;
+	const char *source, *rel, *output;
+	struct module m;
+	struct text t = { NULL, 0, 0 };
+
+	while ((opt = getopt_long (argc, argv, "ah", options, NULL)) != -1)
+	{
+		switch (opt)
+		{
+		case 'a': want_areas = 1; break;
+		case 'h': usage (stdout); return 0;
+		default: usage (stderr); return 1;
+		}
+	}
+	if (optind != argc - 3)
+	{
+		usage (stderr);
+		return 1;
+	}
+	source = argv[optind];
+	rel = argv[optind + 1];
+	output = argv[optind + 2];
+
+	memset (&m, 0, sizeof m);
+	read_source (source, &m);
+	put_preamble (&t, source, rel, output);
+	if (read_rel (rel, &m, want_areas, &t) == 0)
+	{
+		if (remove (output) != 0 && errno != ENOENT)
+			die ("%s: %s", output, strerror (errno));
+		return 0;
+	}
+	write_if_changed (output, &t);
+	return 0;
+}
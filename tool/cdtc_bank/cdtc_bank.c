@@ -0,0 +1,756 @@
+/*
+ * cdtc_bank: build support for code in the extra 64K of a CPC 6128.
+ *
+ * The extra RAM is seen as four 16K banks (4 to 7), one at a time, in
+ * the &4000-&7FFF window, by writing &C4 to &C7 to the gate array (port
+ * &7Fxx); &C0 gives back the main RAM.  Modules placed in a bank are
+ * linked into an image of their own at &4000; the main program must not
+ * use the window.
+ *
+ *   cdtc_bank stubs DIR [--depth N] --main file.rel... --bank N file.rel...
+ *       Write, in DIR, bankN_table.s: a jump table to the functions of
+ *       bank N that code outside it calls, linked first in the bank
+ *       image so that its entries are at &4000, &4003...;
+ *       trampolines.s: for the main program, one trampoline per such
+ *       function under its name, which maps the bank in, calls the
+ *       function and maps back the bank of the caller; and bankN.rels,
+ *       the modules of bank N.  Files are rewritten only when they
+ *       change.  N is the depth of nested cross-bank calls (default 16).
+ *
+ *   cdtc_bank mainsyms MAIN.map OUT.s file.rel...
+ *       Write OUT.s, defining for the bank made of the given modules the
+ *       addresses of the global symbols of the main program, including
+ *       the trampolines to other banks, so that the bank calls the code
+ *       of the main program (and library functions linked there) instead
+ *       of getting copies.
+ *
+ *   cdtc_bank loader NAME N...
+ *       Print an ASCII BASIC loader that loads NAME.BN (N for each bank)
+ *       in each bank and runs NAME.BIN.
+ *
+ *   cdtc_bank report MAIN.map [N BANK.map]...
+ *       Print the areas and free space of the main program and of each
+ *       bank, from the linker maps.  Fails if a bank does not fit in the
+ *       window or the main program uses it.
+ *
+ * Only functions can be used from outside their bank: data of a bank is
+ * only visible while the bank is mapped, i.e. from its own code.  Code
+ * of a bank must not run from interrupts (firmware events), which may
+ * come while another bank is mapped.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LINE 4096
+#define MAX_AREAS 64
+
+#define WINDOW_START 0x4000
+#define WINDOW_END 0x8000
+#define FIRST_BANK 4
+#define LAST_BANK 7
+#define MAIN_BANK (-1)
+
+/* Area flag of asxxxx relocatable files: absolute area. */
+#define AREA_ABS 0x08
+
+static const char *progname = "cdtc_bank";
+
+static void
+die (const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start (ap, fmt);
+	fprintf (stderr, "%s: ", progname);
+	vfprintf (stderr, fmt, ap);
+	fputc ('\n', stderr);
+	va_end (ap);
+	exit (1);
+}
+
+static void *
+xmalloc (size_t size)
+{
+	void *p = malloc (size);
+
+	if (p == NULL)
+		die ("out of memory");
+	return p;
+}
+
+static void *
+xrealloc (void *p, size_t size)
+{
+	p = realloc (p, size);
+	if (p == NULL)
+		die ("out of memory");
+	return p;
+}
+
+static char *
+xstrdup (const char *s)
+{
+	char *p = xmalloc (strlen (s) + 1);
+
+	strcpy (p, s);
+	return p;
+}
+
+/************************************************************************
+ * Output text, written only when it changes
+ ************************************************************************/
+
+struct text
+{
+	char *data;
+	size_t length, allocated;
+};
+
+static void
+text_printf (struct text *t, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	for (;;)
+	{
+		va_start (ap, fmt);
+		n = vsnprintf (t->data + t->length, t->allocated - t->length,
+			       fmt, ap);
+		va_end (ap);
+		if (n < 0)
+			die ("cannot format output");
+		if (t->length + n < t->allocated)
+			break;
+		t->allocated = (t->length + n + 1) * 2;
+		t->data = xrealloc (t->data, t->allocated);
+	}
+	t->length += n;
+}
+
+/* Keep the old file, and its time, when the content is the same. */
+static void
+write_if_changed (const char *filename, const struct text *t)
+{
+	FILE *f = fopen (filename, "rb");
+	char *tmpname;
+
+	if (f != NULL)
+	{
+		char *old = xmalloc (t->length + 1);
+		size_t got = fread (old, 1, t->length + 1, f);
+		int same = got == t->length && memcmp (old, t->data, got) == 0;
+
+		fclose (f);
+		free (old);
+		if (same)
+			return;
+	}
+
+	tmpname = xmalloc (strlen (filename) + 5);
+	sprintf (tmpname, "%s.tmp", filename);
+	f = fopen (tmpname, "wb");
+	if (f == NULL)
+		die ("%s: %s", tmpname, strerror (errno));
+	if (fwrite (t->data, 1, t->length, f) != t->length || fclose (f) != 0)
+		die ("%s: %s", tmpname, strerror (errno));
+	if (rename (tmpname, filename) != 0)
+		die ("%s: %s", filename, strerror (errno));
+	free (tmpname);
+}
+
+/************************************************************************
+ * Symbols of relocatable files
+ ************************************************************************/
+
+struct symbol
+{
+	char *name;
+	int bank;		/* FIRST_BANK..LAST_BANK, or MAIN_BANK */
+	int defined;		/* defined by a module of that bank */
+	int code;		/* defined in area _CODE */
+	int used_outside;	/* referred to from another bank or main */
+	const char *module;
+};
+
+struct symbols
+{
+	struct symbol *v;
+	unsigned int count, allocated;
+};
+
+static struct symbol *
+add_symbol (struct symbols *s)
+{
+	if (s->count == s->allocated)
+	{
+		s->allocated = s->allocated ? s->allocated * 2 : 256;
+		s->v = xrealloc (s->v, s->allocated * sizeof *s->v);
+	}
+	memset (&s->v[s->count], 0, sizeof s->v[s->count]);
+	return &s->v[s->count++];
+}
+
+/* The first letter of the first line (X, D or Q) gives the radix of
+ * numbers in the file. */
+static int
+radix_of (const char *line)
+{
+	switch (line[0])
+	{
+	case 'D': return 10;
+	case 'Q': return 8;
+	default: return 16;
+	}
+}
+
+/* "A name size 1A flags 0 ..." lines open areas, "S name Def0012" and
+ * "S name Ref0000" lines define and refer to global symbols. */
+static void
+read_rel (const char *filename, int bank, struct symbols *defs,
+	  struct symbols *refs)
+{
+	FILE *f = fopen (filename, "r");
+	char line[MAX_LINE], area[MAX_LINE] = "";
+	unsigned int flags = 0;
+	int radix = 16, first = 1;
+
+	if (f == NULL)
+		die ("%s: %s", filename, strerror (errno));
+	while (fgets (line, sizeof line, f) != NULL)
+	{
+		char name[MAX_LINE], size[MAX_LINE], flagtext[MAX_LINE], kind[4];
+
+		if (first)
+		{
+			radix = radix_of (line);
+			first = 0;
+		}
+		if (sscanf (line, "A %s size %s flags %s", name, size, flagtext) == 3)
+		{
+			strcpy (area, name);
+			flags = strtoul (flagtext, NULL, radix);
+		}
+		else if (sscanf (line, "S %s %3s", name, kind) == 2 && name[0] != '.')
+		{
+			struct symbol *s;
+
+			if (strcmp (kind, "Def") == 0)
+			{
+				if (area[0] == '\0' || (flags & AREA_ABS))
+					continue;	/* constants */
+				s = add_symbol (defs);
+				s->defined = 1;
+				s->code = strcmp (area, "_CODE") == 0;
+			}
+			else if (strcmp (kind, "Ref") == 0)
+				s = add_symbol (refs);
+			else
+				continue;
+			s->name = xstrdup (name);
+			s->bank = bank;
+			s->module = filename;
+		}
+	}
+	if (ferror (f))
+		die ("%s: %s", filename, strerror (errno));
+	fclose (f);
+}
+
+static int
+compare_symbol_names (const void *a, const void *b)
+{
+	const struct symbol *sa = a, *sb = b;
+	int c = strcmp (sa->name, sb->name);
+
+	return c ? c : sa->bank - sb->bank;
+}
+
+static struct symbol *
+find_symbol (struct symbols *sorted, const char *name)
+{
+	unsigned int low = 0, high = sorted->count;
+
+	while (low < high)
+	{
+		unsigned int mid = (low + high) / 2;
+		int c = strcmp (sorted->v[mid].name, name);
+
+		if (c == 0)
+			return &sorted->v[mid];
+		if (c < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return NULL;
+}
+
+static int
+parse_bank (const char *s)
+{
+	char *end;
+	long n = strtol (s, &end, 10);
+
+	if (*end != '\0' || n < FIRST_BANK || n > LAST_BANK)
+		die ("%s: not a bank number, expected %d to %d", s, FIRST_BANK, LAST_BANK);
+	return n;
+}
+
+/************************************************************************
+ * stubs
+ ************************************************************************/
+
+static void
+put_runtime (struct text *t, unsigned int depth)
+{
+	text_printf (t,
+		     ";; Calls from outside a bank to a function in it.  Generated by\n"
+		     ";; cdtc_bank, DO NOT EDIT.\n"
+		     ";;\n"
+		     ";; A trampoline takes the name of the function, sets A to the gate\n"
+		     ";; array configuration of its bank, IY to its entry in the jump table\n"
+		     ";; of the bank, and jumps to cdtc_bank_call.  cdtc_bank_call keeps the\n"
+		     ";; stack as the caller left it (arguments, then return address), but\n"
+		     ";; replaces the return address with cdtc_bank_return, after saving it\n"
+		     ";; and the current configuration on a stack of its own.  HL and DE\n"
+		     ";; (__z88dk_fastcall arguments, return values) go through untouched;\n"
+		     ";; A, BC and IY are free to use at a call in SDCC's convention.\n"
+		     "\n"
+		     "\t.module cdtc_banks\n"
+		     "\n"
+		     "\t.area _CODE\n"
+		     "\n"
+		     "cdtc_bank_current:\n"
+		     "\t.db\t0xc0\n"
+		     "cdtc_bank_rsp:\n"
+		     "\t.dw\tcdtc_bank_rstack + %u\n"
+		     "\n"
+		     "cdtc_bank_call:\n"
+		     "\tex\t(sp), hl\n"
+		     "\tpush\tde\n"
+		     "\tpush\taf\n"
+		     "\tex\tde, hl\n"
+		     "\tld\thl, (cdtc_bank_rsp)\n"
+		     "\tdec\thl\n"
+		     "\tld\t(hl), d\n"
+		     "\tdec\thl\n"
+		     "\tld\t(hl), e\n"
+		     "\tdec\thl\n"
+		     "\tld\ta, (cdtc_bank_current)\n"
+		     "\tld\t(hl), a\n"
+		     "\tld\t(cdtc_bank_rsp), hl\n"
+		     "\tpop\taf\n"
+		     "\tld\t(cdtc_bank_current), a\n"
+		     "\tld\tb, #0x7f\n"
+		     "\tout\t(c), a\n"
+		     "\tpop\tde\n"
+		     "\tld\thl, #cdtc_bank_return\n"
+		     "\tex\t(sp), hl\n"
+		     "\tjp\t(iy)\n"
+		     "\n"
+		     "cdtc_bank_return:\n"
+		     "\tpush\thl\n"
+		     "\tld\thl, (cdtc_bank_rsp)\n"
+		     "\tld\ta, (hl)\n"
+		     "\tld\t(cdtc_bank_current), a\n"
+		     "\tld\tb, #0x7f\n"
+		     "\tout\t(c), a\n"
+		     "\tinc\thl\n"
+		     "\tld\tc, (hl)\n"
+		     "\tinc\thl\n"
+		     "\tld\tb, (hl)\n"
+		     "\tinc\thl\n"
+		     "\tld\t(cdtc_bank_rsp), hl\n"
+		     "\tpop\thl\n"
+		     "\tpush\tbc\n"
+		     "\tret\n"
+		     "\n",
+		     depth * 3);
+}
+
+static int
+stubs (int argc, char **argv)
+{
+	struct symbols defs = { NULL, 0, 0 }, refs = { NULL, 0, 0 };
+	struct text trampolines = { NULL, 0, 0 };
+	struct text tables[LAST_BANK + 1], rels[LAST_BANK + 1];
+	unsigned int entries[LAST_BANK + 1], depth = 16, i;
+	int present[LAST_BANK + 1];
+	const char *dir;
+	int bank = MAIN_BANK, n, errors = 0;
+	char *filename;
+
+	if (argc < 1)
+		die ("stubs: expected DIR");
+	dir = argv[0];
+	memset (tables, 0, sizeof tables);
+	memset (rels, 0, sizeof rels);
+	memset (entries, 0, sizeof entries);
+	memset (present, 0, sizeof present);
+	for (i = 1; i < (unsigned int) argc; i++)
+	{
+		if (strcmp (argv[i], "--main") == 0)
+			bank = MAIN_BANK;
+		else if (strcmp (argv[i], "--bank") == 0 && i + 1 < (unsigned int) argc)
+		{
+			bank = parse_bank (argv[++i]);
+			present[bank] = 1;
+		}
+		else if (strcmp (argv[i], "--depth") == 0 && i + 1 < (unsigned int) argc)
+			depth = strtoul (argv[++i], NULL, 0);
+		else
+		{
+			read_rel (argv[i], bank, &defs, &refs);
+			if (bank != MAIN_BANK)
+				text_printf (&rels[bank], "%s\n", argv[i]);
+		}
+	}
+
+	qsort (defs.v, defs.count, sizeof *defs.v, compare_symbol_names);
+	for (i = 0; i + 1 < defs.count; i++)
+		if (strcmp (defs.v[i].name, defs.v[i + 1].name) == 0
+		    && defs.v[i].bank != defs.v[i + 1].bank)
+		{
+			fprintf (stderr, "%s: %s is defined in both %s and %s\n", progname,
+				 defs.v[i].name, defs.v[i].module, defs.v[i + 1].module);
+			errors++;
+		}
+	for (i = 0; i < refs.count; i++)
+	{
+		struct symbol *d = find_symbol (&defs, refs.v[i].name);
+
+		if (d != NULL && d->bank != MAIN_BANK && d->bank != refs.v[i].bank)
+		{
+			if (!d->code && !d->used_outside)
+			{
+				fprintf (stderr, "%s: %s, data of bank %d (%s), is used by %s: only functions can be used outside their bank\n",
+					 progname, d->name, d->bank, d->module, refs.v[i].module);
+				errors++;
+			}
+			d->used_outside = 1;
+		}
+	}
+	if (errors)
+		return 1;
+
+	put_runtime (&trampolines, depth);
+	for (bank = FIRST_BANK; bank <= LAST_BANK; bank++)
+	{
+		if (!present[bank])
+			continue;
+		text_printf (&tables[bank],
+			     ";; Entries of bank %d, at &4000 + 3 * n, for trampolines.s.\n"
+			     ";; Generated by cdtc_bank, DO NOT EDIT.\n"
+			     "\n"
+			     "\t.module cdtc_bank%d_table\n"
+			     "\n"
+			     "\t;; The order of areas in the bank image.\n"
+			     "\t.area _CODE\n"
+			     "\t.area _GSINIT\n"
+			     "\t.area _GSFINAL\n"
+			     "\t.area _DATA\n"
+			     "\t.area _HOME\n"
+			     "\t.area _INITIALIZER\n"
+			     "\t.area _INITIALIZED\n"
+			     "\n"
+			     "\t.area _CODE\n"
+			     "\n",
+			     bank, bank);
+		for (i = 0; i < defs.count; i++)
+		{
+			struct symbol *d = &defs.v[i];
+
+			if (d->bank != bank || !d->used_outside)
+				continue;
+			text_printf (&tables[bank], "\tjp\t%s\n", d->name);
+			text_printf (&trampolines,
+				     "%s::\n"
+				     "\tld\ta, #0x%02x\n"
+				     "\tld\tiy, #0x%04x\n"
+				     "\tjp\tcdtc_bank_call\n",
+				     d->name, 0xc0 + bank, WINDOW_START + 3 * entries[bank]);
+			entries[bank]++;
+		}
+	}
+	text_printf (&trampolines,
+		     "\n"
+		     "\t.area _DATA\n"
+		     "\n"
+		     "cdtc_bank_rstack:\n"
+		     "\t.ds\t%u\n",
+		     depth * 3);
+
+	filename = xmalloc (strlen (dir) + 32);
+	sprintf (filename, "%s/trampolines.s", dir);
+	write_if_changed (filename, &trampolines);
+	for (bank = FIRST_BANK; bank <= LAST_BANK; bank++)
+	{
+		if (!present[bank])
+			continue;
+		sprintf (filename, "%s/bank%d_table.s", dir, bank);
+		write_if_changed (filename, &tables[bank]);
+		sprintf (filename, "%s/bank%d.rels", dir, bank);
+		write_if_changed (filename, &rels[bank]);
+		n = entries[bank];
+		fprintf (stderr, "%s: bank %d: %d function%s called from outside\n",
+			 progname, bank, n, n == 1 ? "" : "s");
+	}
+	free (filename);
+	return 0;
+}
+
+/************************************************************************
+ * Linker maps
+ ************************************************************************/
+
+/* "     00004000  _main     main" lines give global symbols. */
+static int
+map_symbol (const char *line, char *name, unsigned long *value)
+{
+	char hex[MAX_LINE];
+
+	if (sscanf (line, "%s %s", hex, name) != 2
+	    || strlen (hex) != 8 || strspn (hex, "0123456789ABCDEFabcdef") != 8)
+		return 0;
+	*value = strtoul (hex, NULL, 16);
+	return 1;
+}
+
+struct map_area
+{
+	char *name;
+	unsigned long addr, size;
+};
+
+/* "_CODE   00004000    0000022C =   556. bytes (REL,CON)" lines give
+ * areas. */
+static unsigned int
+read_map_areas (const char *filename, struct map_area *areas)
+{
+	FILE *f = fopen (filename, "r");
+	char line[MAX_LINE];
+	unsigned int count = 0;
+
+	if (f == NULL)
+		die ("%s: %s", filename, strerror (errno));
+	while (fgets (line, sizeof line, f) != NULL)
+	{
+		char name[MAX_LINE];
+		unsigned long addr, size;
+
+		if (sscanf (line, "%s %lx %lx =", name, &addr, &size) == 3
+		    && strstr (line, " bytes (") != NULL
+		    && strstr (line, "ABS") == NULL
+		    && count < MAX_AREAS)
+		{
+			areas[count].name = xstrdup (name);
+			areas[count].addr = addr;
+			areas[count].size = size;
+			count++;
+		}
+	}
+	fclose (f);
+	return count;
+}
+
+/* Linker made symbols (area starts and lengths), each image has its own. */
+static int
+is_linker_symbol (const char *name)
+{
+	return name[0] == '.' || strncmp (name, "s__", 3) == 0
+		|| strncmp (name, "l__", 3) == 0;
+}
+
+static int
+mainsyms (int argc, char **argv)
+{
+	struct symbols defs = { NULL, 0, 0 }, refs = { NULL, 0, 0 };
+	struct text t = { NULL, 0, 0 };
+	const char *mapname, *output;
+	char line[MAX_LINE];
+	int i;
+	FILE *f;
+
+	if (argc < 2)
+		die ("mainsyms: expected MAIN.map OUT.s file.rel...");
+	mapname = argv[0];
+	output = argv[1];
+	for (i = 2; i < argc; i++)
+		read_rel (argv[i], FIRST_BANK, &defs, &refs);
+	qsort (defs.v, defs.count, sizeof *defs.v, compare_symbol_names);
+
+	text_printf (&t,
+		     ";; Addresses in the main program, from %s, for a bank.\n"
+		     ";; Generated by cdtc_bank, DO NOT EDIT.\n"
+		     "\n"
+		     "\t.module cdtc_bank_main\n"
+		     "\n",
+		     mapname);
+	f = fopen (mapname, "r");
+	if (f == NULL)
+		die ("%s: %s", mapname, strerror (errno));
+	while (fgets (line, sizeof line, f) != NULL)
+	{
+		char name[MAX_LINE];
+		unsigned long value;
+
+		if (map_symbol (line, name, &value)
+		    && !is_linker_symbol (name)
+		    && find_symbol (&defs, name) == NULL)
+			text_printf (&t, "%s == 0x%04lx\n", name, value & 0xffff);
+	}
+	fclose (f);
+	write_if_changed (output, &t);
+	return 0;
+}
+
+static int
+report (int argc, char **argv)
+{
+	struct map_area areas[MAX_AREAS];
+	int i, errors = 0;
+
+	if (argc < 1 || argc % 2 != 1)
+		die ("report: expected MAIN.map [N BANK.map]...");
+	for (i = -1; i < argc; i += 2)
+	{
+		const char *mapname = i < 0 ? argv[0] : argv[i + 1];
+		int bank = i < 0 ? MAIN_BANK : parse_bank (argv[i]);
+		unsigned int count, j;
+		unsigned long low = 0xffffffUL, high = 0, used = 0;
+
+		count = read_map_areas (mapname, areas);
+		for (j = 0; j < count; j++)
+		{
+			if (areas[j].size == 0)
+				continue;
+			if (areas[j].addr < low)
+				low = areas[j].addr;
+			if (areas[j].addr + areas[j].size > high)
+				high = areas[j].addr + areas[j].size;
+			used += areas[j].size;
+		}
+		if (used == 0)
+			low = high = WINDOW_START;
+		if (bank == MAIN_BANK)
+			printf ("main    &%04lX-&%04lX %6lu bytes\n", low, high - 1, used);
+		else
+			printf ("bank %d  &%04lX-&%04lX %6lu bytes, %6lu free\n", bank, low,
+				high - 1, used, high <= WINDOW_END ? WINDOW_END - high : 0);
+		for (j = 0; j < count; j++)
+			if (areas[j].size != 0)
+				printf ("          %-16s &%04lX %6lu\n", areas[j].name,
+					areas[j].addr, areas[j].size);
+
+		for (j = 0; j < count; j++)
+		{
+			unsigned long start = areas[j].addr, end = start + areas[j].size;
+
+			if (areas[j].size == 0)
+				continue;
+			if (bank == MAIN_BANK && start < WINDOW_END && end > WINDOW_START)
+			{
+				fprintf (stderr, "%s: %s: area %s (&%04lX-&%04lX) is in the bank window &4000-&7FFF: set CODELOC out of it\n",
+					 progname, mapname, areas[j].name, start, end - 1);
+				errors++;
+			}
+			if (bank != MAIN_BANK && (start < WINDOW_START || end > WINDOW_END))
+			{
+				fprintf (stderr, "%s: %s: area %s (&%04lX-&%04lX) does not fit in bank %d\n",
+					 progname, mapname, areas[j].name, start, end - 1, bank);
+				errors++;
+			}
+			if (bank != MAIN_BANK && strcmp (areas[j].name, "_GSINIT") == 0)
+			{
+				fprintf (stderr, "%s: %s: bank %d has initialization code (_GSINIT), which would never run\n",
+					 progname, mapname, bank);
+				errors++;
+			}
+		}
+	}
+	return errors ? 1 : 0;
+}
+
+/************************************************************************
+ * BASIC loader
+ ************************************************************************/
+
+/* The name on disc, as cdtc_pack makes it. */
+static void
+disc_name (char out[9], const char *name)
+{
+	int i;
+
+	for (i = 0; i < 8 && name[i] != '\0' && name[i] != '.'; i++)
+	{
+		int c = toupper ((unsigned char) name[i]);
+
+		out[i] = (isalnum (c) || c == '_' || c == '-') ? c : '_';
+	}
+	out[i] = '\0';
+}
+
+static int
+loader (int argc, char **argv)
+{
+	char name[9];
+	int i, line = 10;
+
+	if (argc < 1)
+		die ("loader: expected NAME N...");
+	disc_name (name, argv[0]);
+	for (i = 1; i < argc; i++, line += 10)
+	{
+		int bank = parse_bank (argv[i]);
+
+		printf ("%d OUT &7F00,&%02X:LOAD\"%s.B%d\",&4000\r\n", line, 0xc0 + bank, name, bank);
+	}
+	printf ("%d OUT &7F00,&C0:RUN\"%s.BIN\"\r\n", line, name);
+	return 0;
+}
+
+/************************************************************************
+ * Main
+ ************************************************************************/
+
+static void
+usage (FILE *f)
+{
+	fprintf (f,
+		 "Usage: %s stubs DIR [--depth N] --main file.rel... --bank N file.rel...\n"
+		 "       %s mainsyms MAIN.map OUT.s file.rel...\n"
+		 "       %s loader NAME N...\n"
+		 "       %s report MAIN.map [N BANK.map]...\n",
+		 progname, progname, progname, progname);
+}
+
+int
+main (int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		usage (stderr);
+		return 1;
+	}
+	if (strcmp (argv[1], "stubs") == 0)
+		return stubs (argc - 2, argv + 2);
+	if (strcmp (argv[1], "mainsyms") == 0)
+		return mainsyms (argc - 2, argv + 2);
+	if (strcmp (argv[1], "loader") == 0)
+		return loader (argc - 2, argv + 2);
+	if (strcmp (argv[1], "report") == 0)
+		return report (argc - 2, argv + 2);
+	if (strcmp (argv[1], "--help") == 0 || strcmp (argv[1], "-h") == 0)
+	{
+		usage (stdout);
+		return 0;
+	}
+	usage (stderr);
+	return 1;
+}
@@ -0,0 +1,274 @@
+#!/bin/bash
+
+# Object cache for SDCC compilations, in the spirit of ccache.
+#
+# Usage:
+#   cdtc_cache.sh compiler args...   compile through the cache
+#   cdtc_cache.sh --stats            show hit/miss statistics
+#   cdtc_cache.sh --zero-stats       reset statistics
+#   cdtc_cache.sh --cleanup          evict entries until under size limit
+#   cdtc_cache.sh --clear            remove all entries
+#
+# Only "compiler ... -c source.c -o object.rel" invocations are cached,
+# anything else (e.g. linking) is run unchanged.  The cache key covers:
+# * the preprocessed source (so included headers are covered),
+# * the compiler version as reported by the compiler itself,
+# * the content of each file listed in CDTC_CACHE_KEY_FILES (the
+#   makefile passes tool/sdcc/build_config.inc, which names the SDCC
+#   version in use),
+# * every compiler argument except source and output names,
+# * the content of the rules file given with --peep-file, if any.
+#
+# Environment:
+#   CDTC_CACHE_DIR      where entries live, default: cache/ next to this script
+#   CDTC_CACHE_MAXSIZE  size bound in KiB, default 65536 (64 MiB)
+#   CDTC_CACHE_KEY_FILES  extra files whose content is part of the key
+#   CDTC_CACHE_DISABLE  if non-empty, always compile without cache
+
+set -eu -o pipefail
+
+SCRIPTDIR="$( cd -P "$( dirname "$0" )" ; pwd )"
+CACHEDIR="${CDTC_CACHE_DIR:-${SCRIPTDIR}/cache}"
+MAXSIZE="${CDTC_CACHE_MAXSIZE:-65536}"
+
+# Files that SDCC writes next to the object file, and that we keep.
+OUTPUT_SUFFIXES="rel asm lst sym adb"
+
+# Counts past this many bytes of events are folded into stats/NAME.count.
+STATS_FOLD_BYTES=65536
+
+# Events of stats/NAME: those folded in NAME.count, plus one per line.
+function count_events()
+{
+    local FOLDED=0 LINES=0
+    [[ ! -r "$1.count" ]] || FOLDED=$( cat "$1.count" )
+    [[ ! -r "$1" ]] || LINES=$( wc -l <"$1" | tr -d ' ' )
+    echo $(( FOLDED + LINES ))
+}
+
+function record()
+{
+    mkdir -p "${CACHEDIR}/stats"
+    # One short append per event: atomic, even with make -j.
+    echo >>"${CACHEDIR}/stats/$1"
+}
+
+# Keep the stats files small: past STATS_FOLD_BYTES, the lines of an
+# event file go into its count.  The file is renamed first, so that
+# events appended meanwhile go to a new one and are not lost.
+function fold_stats()
+{
+    local FILE SIZE FOLDED
+    for FILE in "${CACHEDIR}"/stats/hits "${CACHEDIR}"/stats/misses "${CACHEDIR}"/stats/uncacheable "${CACHEDIR}"/stats/evicted
+    do
+        [[ -r "$FILE" ]] || continue
+        SIZE=$( stat -c %s "$FILE" )
+        [[ "$SIZE" -gt "$STATS_FOLD_BYTES" ]] || continue
+        mv -f "$FILE" "$FILE.folding.$$" 2>/dev/null || continue
+        FOLDED=0
+        [[ ! -r "$FILE.count" ]] || FOLDED=$( cat "$FILE.count" )
+        echo $(( FOLDED + $( wc -l <"$FILE.folding.$$" ) )) >"$FILE.count.tmp.$$"
+        mv -f "$FILE.count.tmp.$$" "$FILE.count"
+        rm -f "$FILE.folding.$$"
+    done
+}
+
+function cache_size_kib()
+{
+    if [[ -d "${CACHEDIR}/objects" ]]
+    then du -sk "${CACHEDIR}/objects" | cut -f 1
+    else echo 0
+    fi
+}
+
+function show_stats()
+{
+    local HITS MISSES UNCACHEABLE TOTAL ENTRIES
+    HITS=$( count_events "${CACHEDIR}/stats/hits" )
+    MISSES=$( count_events "${CACHEDIR}/stats/misses" )
+    UNCACHEABLE=$( count_events "${CACHEDIR}/stats/uncacheable" )
+    EVICTED=$( count_events "${CACHEDIR}/stats/evicted" )
+    TOTAL=$(( HITS + MISSES ))
+    ENTRIES=$( shopt -s nullglob ; set -- "${CACHEDIR}"/objects/*/* ; echo $# )
+    echo "cache directory       ${CACHEDIR}"
+    echo "cache hits            ${HITS}"
+    echo "cache misses          ${MISSES}"
+    if [[ "$TOTAL" != 0 ]]
+    then
+        echo "hit rate              $(( HITS * 100 / TOTAL )) %"
+    fi
+    echo "uncacheable calls     ${UNCACHEABLE}"
+    echo "evicted entries       ${EVICTED}"
+    echo "entries               ${ENTRIES}"
+    echo "cache size            $( cache_size_kib ) KiB"
+    echo "max cache size        ${MAXSIZE} KiB"
+}
+
+# "MTIME<tab>KIB<tab>ENTRY" per entry, least recently used first.  The
+# size is that of its files, plus 4 KiB for the directory itself.
+function entries_by_age()
+{
+    {
+        find "${CACHEDIR}/objects" -mindepth 2 -maxdepth 2 -type d -printf 'D\t%T@\t%p\n'
+        find "${CACHEDIR}/objects" -mindepth 3 -maxdepth 3 -type f -printf 'F\t%k\t%h\n'
+    } | awk -F '\t' -v OFS='\t' '
+$1 == "D" { mtime[$3] = $2 }
+$1 == "F" { size[$3] += $2 }
+END { for (e in mtime) print mtime[e], size[e] + 4, e }
+' | sort -n -k1,1
+}
+
+# Least recently used entries go first.  A hit touches its entry.
+# Sizes and ages are read once, each eviction subtracts its size.
+function cleanup()
+{
+    local TOTAL LIMIT MTIME SIZE ENTRY
+    fold_stats
+    TOTAL=$( cache_size_kib )
+    [[ "$TOTAL" -gt "$MAXSIZE" ]] || return 0
+    # Evict down to 90% of the bound, so that we don't evict on every miss.
+    LIMIT=$(( MAXSIZE * 9 / 10 ))
+    while IFS=$'\t' read -r MTIME SIZE ENTRY
+    do
+        [[ "$TOTAL" -gt "$LIMIT" ]] || break
+        rm -rf "$ENTRY"
+        TOTAL=$(( TOTAL - SIZE ))
+        record evicted
+    done < <( entries_by_age )
+}
+
+case "${1:-}" in
+    --stats) show_stats ; exit 0 ;;
+    --zero-stats) rm -rf "${CACHEDIR}/stats" ; exit 0 ;;
+    --cleanup) cleanup ; exit 0 ;;
+    --clear) rm -rf "${CACHEDIR}/objects" ; exit 0 ;;
+    "") echo >&2 "Usage: $0 compiler args... | --stats | --zero-stats | --cleanup | --clear" ; exit 1 ;;
+esac
+
+########################################################################
+# Figure out if this is a cacheable compilation
+########################################################################
+
+COMPILER="$1"
+
+OUTPUT=""
+SOURCE=""
+COMPILE_ONLY=""
+# Arguments that influence the object code, i.e. all but source and output.
+KEY_ARGS=()
+# Files named by arguments, whose content influences the object code.
+ARG_KEY_FILES=()
+
+ARGS=( "$@" )
+for (( I = 1 ; I < ${#ARGS[@]} ; I++ ))
+do
+    ARG="${ARGS[$I]}"
+    case "$ARG" in
+        -c) COMPILE_ONLY=yes ;;
+        -o) I=$(( I + 1 )) ; OUTPUT="${ARGS[$I]:-}" ;;
+        --peep-file) I=$(( I + 1 )) ; KEY_ARGS+=( "$ARG" "${ARGS[$I]:-}" ) ; ARG_KEY_FILES+=( "${ARGS[$I]:-}" ) ;;
+        *.c) if [[ -n "$SOURCE" ]] ; then SOURCE="" ; break ; fi ; SOURCE="$ARG" ;;
+        *) KEY_ARGS+=( "$ARG" ) ;;
+    esac
+done
+
+if [[ -n "${CDTC_CACHE_DISABLE:-}" || -z "$COMPILE_ONLY" || -z "$SOURCE" || "$OUTPUT" != *.rel ]]
+then
+    [[ -n "$COMPILE_ONLY" ]] && record uncacheable
+    exec "$@"
+fi
+
+OUTBASE="${OUTPUT%.rel}"
+
+########################################################################
+# Compute key
+########################################################################
+
+# Same command line, preprocessing only.
+PREPROCESS=( "$COMPILER" "${KEY_ARGS[@]}" -E "$SOURCE" )
+
+if ! KEY=$( {
+    echo "cdtc_cache 1"
+    "$COMPILER" -v 2>&1 || true
+    for KEYFILE in ${CDTC_CACHE_KEY_FILES:-} ${ARG_KEY_FILES[@]+"${ARG_KEY_FILES[@]}"}
+    do
+        echo "== ${KEYFILE}"
+        cat "$KEYFILE"
+    done
+    echo "== args"
+    printf '%s\n' "${KEY_ARGS[@]}"
+    echo "== preprocessed"
+    "${PREPROCESS[@]}" 2>/dev/null
+} | sha1sum | cut -c 1-40 )
+then
+    # Let the real compiler report the problem.
+    record uncacheable
+    exec "$@"
+fi
+
+ENTRY="${CACHEDIR}/objects/${KEY:0:2}/${KEY:2}"
+
+########################################################################
+# Hit
+########################################################################
+
+if [[ -r "${ENTRY}/rel" ]]
+then
+    for SUFFIX in $OUTPUT_SUFFIXES
+    do
+        if [[ -r "${ENTRY}/${SUFFIX}" ]]
+        then
+            cp -f "${ENTRY}/${SUFFIX}" "${OUTBASE}.${SUFFIX}.tmp"
+            mv -f "${OUTBASE}.${SUFFIX}.tmp" "${OUTBASE}.${SUFFIX}"
+        fi
+    done
+    # Replay warnings, so that a cached build reads like a real one.
+    cat "${ENTRY}/stdout"
+    cat >&2 "${ENTRY}/stderr"
+    touch "$ENTRY"
+    record hits
+    echo >&2 "cdtc_cache: hit ${SOURCE} -> ${OUTPUT}"
+    exit 0
+fi
+
+########################################################################
+# Miss
+########################################################################
+
+record misses
+
+mkdir -p "${CACHEDIR}/objects/${KEY:0:2}"
+NEWENTRY="$( mktemp -d "${ENTRY}.XXXXXX" )"
+trap 'rm -rf "$NEWENTRY"' EXIT
+
+# Only keep files written by this very compilation.
+touch "${NEWENTRY}/started"
+
+RC=0
+"$@" >"${NEWENTRY}/stdout" 2>"${NEWENTRY}/stderr" || RC=$?
+cat "${NEWENTRY}/stdout"
+cat >&2 "${NEWENTRY}/stderr"
+
+if [[ "$RC" != 0 ]]
+then
+    exit "$RC"
+fi
+
+for SUFFIX in $OUTPUT_SUFFIXES
+do
+    if [[ -r "${OUTBASE}.${SUFFIX}" && ! "${OUTBASE}.${SUFFIX}" -ot "${NEWENTRY}/started" ]]
+    then
+        cp -f "${OUTBASE}.${SUFFIX}" "${NEWENTRY}/${SUFFIX}"
+    fi
+done
+rm -f "${NEWENTRY}/started"
+
+# Publish with a rename.  If a concurrent compilation won, keep its entry.
+if [[ -r "${NEWENTRY}/rel" && ! -e "$ENTRY" ]] && mv "$NEWENTRY" "$ENTRY" 2>/dev/null
+then
+    trap - EXIT
+fi
+
+cleanup
+
+exit 0
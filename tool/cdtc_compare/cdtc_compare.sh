@@ -0,0 +1,174 @@
+#!/bin/bash
+
+# Compare builds of the same program made with different compiler flags.
+#
+# Usage:
+#   cdtc_compare.sh [--call SYM[:ARG...]]... NAME:PREFIX...
+#
+# Each NAME:PREFIX is one build: PREFIX.ihx and PREFIX.map are the
+# linked program, the .rel files under the directory of PREFIX its
+# objects.  "make compare-profiles" passes one per profile, e.g.
+# size:build-size/foo.
+#
+# Prints a table with one column per build:
+#   - the size in bytes of each function, from the _CODE area of each
+#     .rel file: from its global symbol to the next one, so static
+#     functions count in the global function before them;
+#   - the bytes of the whole program, from the .ihx;
+#   - for each --call, the NOPs the routine takes in cdtc_sim, called
+#     with its 16-bit arguments right after loading, "-" if it did not
+#     return.  cdtc_sim must be in the PATH.
+
+set -eu -o pipefail
+
+CALLS=()
+while [[ $# -gt 0 && "$1" == --call ]]
+do
+    [[ $# -ge 2 ]] || { echo >&2 "$0: --call needs a routine" ; exit 2 ; }
+    CALLS+=("$2")
+    shift 2
+done
+if [[ $# -eq 0 ]]
+then
+    echo >&2 "Usage: $0 [--call SYM[:ARG...]]... NAME:PREFIX..."
+    exit 2
+fi
+
+# "NAME MODULE FUNCTION BYTES" lines, tab separated, for one build.
+function function_sizes()
+{
+    local NAME="$1" DIR="$2"
+    find "$DIR" -name '*.rel' -print0 | sort -z | xargs -0 -r awk -v build="$NAME" -v OFS='\t' '
+function num(s,   i, n, c)
+{
+    n = 0
+    s = toupper(s)
+    for (i = 1; i <= length(s); i++)
+    {
+        c = index("0123456789ABCDEF", substr(s, i, 1)) - 1
+        if (c < 0 || c >= radix)
+            break
+        n = n * radix + c
+    }
+    return n
+}
+# Global symbols of the _CODE area, in address order, each up to the next.
+function flush(   i, j, t)
+{
+    if (area != "_CODE")
+        return
+    for (i = 1; i < count; i++)
+        for (j = i; j > 0 && offset[j - 1] > offset[j]; j--)
+        {
+            t = offset[j]; offset[j] = offset[j - 1]; offset[j - 1] = t
+            t = name[j]; name[j] = name[j - 1]; name[j - 1] = t
+        }
+    for (i = 0; i < count; i++)
+        print build, module, name[i], (i + 1 < count ? offset[i + 1] : size) - offset[i]
+}
+FNR == 1 {
+    flush()
+    radix = substr($0, 1, 1) == "D" ? 10 : substr($0, 1, 1) == "Q" ? 8 : 16
+    module = FILENAME
+    sub(/.*\//, "", module)
+    sub(/\.rel$/, "", module)
+    area = ""
+    count = 0
+}
+$1 == "A" {
+    flush()
+    area = $2
+    size = num($4)
+    count = 0
+}
+$1 == "S" && substr($3, 1, 3) == "Def" && area == "_CODE" {
+    name[count] = $2
+    offset[count] = num(substr($3, 4))
+    count++
+}
+END { flush() }
+'
+}
+
+# Data bytes of an Intel hex file.
+function ihx_bytes()
+{
+    local LINE TOTAL=0
+    while read -r LINE
+    do
+        LINE="${LINE%$'\r'}"
+        [[ "${LINE:7:2}" == 00 ]] && TOTAL=$(( TOTAL + 16#${LINE:1:2} ))
+    done <"$1"
+    echo "$TOTAL"
+}
+
+function call_nops()
+{
+    local PREFIX="$1" SPEC="$2" SYM ARGS=() ARG
+    IFS=: read -r -a ARGS <<<"$SPEC"
+    SYM="${ARGS[0]}"
+    ARGS=("${ARGS[@]:1}")
+    set -- -l "${PREFIX}.ihx" -m "${PREFIX}.map" -c "$SYM"
+    for ARG in "${ARGS[@]}"
+    do set -- "$@" -a "$ARG"
+    done
+    cdtc_sim "$@" 2>&1 | sed -n 's/^cdtc_sim: returned .* \([0-9]*\) NOPs$/\1/p' | grep . || echo -
+}
+
+NAMES=()
+for BUILD in "$@"
+do
+    [[ -r "${BUILD#*:}.ihx" ]] || { echo >&2 "$0: ${BUILD#*:}.ihx not found" ; exit 1 ; }
+    NAMES+=("${BUILD%%:*}")
+done
+
+{
+    for BUILD in "$@"
+    do
+        NAME="${BUILD%%:*}"
+        PREFIX="${BUILD#*:}"
+        function_sizes "$NAME" "$( dirname "$PREFIX" )"
+        printf "%s\t=\t%s\t%s\n" "$NAME" "program bytes" "$( ihx_bytes "${PREFIX}.ihx" )"
+        for SPEC in ${CALLS[@]+"${CALLS[@]}"}
+        do printf "%s\t=\t%s\t%s\n" "$NAME" "NOPs ${SPEC%%:*}" "$( call_nops "$PREFIX" "$SPEC" )"
+        done
+    done
+} | awk -v builds="${NAMES[*]}" -F '\t' '
+BEGIN { nbuild = split(builds, build, " ") }
+# Module "=" marks the rows about the whole program.
+function row(key, label,   b)
+{
+    printf "%-16s %-28s", (label == "" ? module_of[key] : ""), (label == "" ? function_of[key] : label)
+    for (b = 1; b <= nbuild; b++)
+        printf " %10s", ((key, build[b]) in value) ? value[key, build[b]] : "-"
+    printf "\n"
+}
+{
+    key = $2 SUBSEP $3
+    if (!(key in module_of))
+    {
+        module_of[key] = $2
+        function_of[key] = $3
+        order[nkey++] = key
+    }
+    value[key, $1] = $4
+    if ($2 != "=")
+        total[$1] += $4
+}
+END {
+    printf "%-16s %-28s", "module", "function"
+    for (b = 1; b <= nbuild; b++)
+        printf " %10s", build[b]
+    printf "\n"
+    for (k = 0; k < nkey; k++)
+        if (module_of[order[k]] != "=")
+            row(order[k], "")
+    printf "%-16s %-28s", "", "all functions"
+    for (b = 1; b <= nbuild; b++)
+        printf " %10d", total[build[b]]
+    printf "\n"
+    for (k = 0; k < nkey; k++)
+        if (module_of[order[k]] == "=")
+            row(order[k], function_of[order[k]])
+}
+'
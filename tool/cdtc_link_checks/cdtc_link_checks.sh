@@ -0,0 +1,83 @@
+#!/bin/bash
+
+# Checks of a program once linked, from its map.  The link rule of
+# sdcc-project.Makefile runs them and removes the program if one fails.
+#
+# Usage:
+#   cdtc_link_checks.sh MAP [--align REPORT] [--fwoff STACK] [--tables SPEC...]
+#
+# --align REPORT   if REPORT exists, area _ALIGNED256 is where
+#                  cdtc_align placed it (see cdtc_align.sh check);
+#                  REPORT is printed.
+# --fwoff STACK    for CDTC_FIRMWARE=off: prints how far the program and
+#                  its variables go.  The loaded part must end below
+#                  &A680, where AMSDOS lives while it loads, and STACK
+#                  bytes must be left for the stack below &C000.
+# --tables SPEC... the tables of these files are where cdtc_table
+#                  expects them (cdtc_table --check, which must be in
+#                  the PATH).
+#
+# Exits 1 if a check fails.
+
+set -eu -o pipefail
+
+SCRIPTDIR="$( cd -P "$( dirname "$0" )" ; pwd )"
+CDTC_ALIGN="${SCRIPTDIR}/../cdtc_align/cdtc_align.sh"
+
+function usage()
+{
+    echo >&2 "Usage: $0 MAP [--align REPORT] [--fwoff STACK] [--tables SPEC...]"
+    exit 2
+}
+
+[[ $# -ge 1 ]] || usage
+MAP="$1"
+shift
+PROGRAM="${MAP%.map}.ihx"
+ALIGN_REPORT=
+FWOFF_STACK=
+TABLESPECS=()
+while [[ $# -gt 0 ]]
+do
+    case "$1" in
+        --align) [[ $# -ge 2 ]] || usage ; ALIGN_REPORT="$2" ; shift 2 ;;
+        --fwoff) [[ $# -ge 2 ]] || usage ; FWOFF_STACK="$2" ; shift 2 ;;
+        --tables) shift ; TABLESPECS=( "$@" ) ; break ;;
+        *) usage ;;
+    esac
+done
+
+if [[ -n "$ALIGN_REPORT" && -f "$ALIGN_REPORT" ]]
+then
+    "$CDTC_ALIGN" check "$MAP" "$ALIGN_REPORT"
+    cat "$ALIGN_REPORT"
+fi
+
+if [[ -n "$FWOFF_STACK" ]]
+then
+    LOADTOP=0
+    TOP=0
+    while read -r AREA ADDR SIZE EQ REST
+    do
+        [[ "$EQ" == "=" ]] || continue
+        END=$(( 16#$ADDR + 16#$SIZE ))
+        (( END > TOP )) && TOP=$END
+        [[ "$AREA" == _DATA || "$AREA" == _INITIALIZED ]] || { (( END > LOADTOP )) && LOADTOP=$END ; }
+    done <"$MAP"
+    printf "%s: firmware off: loaded up to &%04X; variables up to &%04X; %d bytes left for the stack.\n" "$PROGRAM" $(( LOADTOP - 1 )) $(( TOP - 1 )) $(( 0xC000 - TOP ))
+    if (( LOADTOP > 0xA680 ))
+    then
+        echo >&2 "$PROGRAM: the loaded part must end below &A680 to be loaded by AMSDOS."
+        exit 1
+    fi
+    if (( TOP > 0xC000 - FWOFF_STACK ))
+    then
+        echo >&2 "$PROGRAM: less than CDTC_FWOFF_STACK=$FWOFF_STACK bytes left for the stack."
+        exit 1
+    fi
+fi
+
+if [[ ${#TABLESPECS[@]} -gt 0 ]]
+then
+    cdtc_table --check "$MAP" "${TABLESPECS[@]}"
+fi
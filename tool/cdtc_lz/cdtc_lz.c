@@ -0,0 +1,627 @@
+/*
+ * cdtc_lz: LZ compression made for the Z80 decompressors of
+ * cpclib/cdtc_lz.
+ *
+ * Stream format, a sequence of tokens:
+ *   &00         end of stream
+ *   &01-&7F     that many literal bytes follow
+ *   &80-&BF     match of (token & &3F) + 2 bytes, one offset byte xx
+ *               follows, the match starts at output - 256 + xx
+ *   &C0-&FF     match of (token & &3F) + 3 bytes, a 16-bit little
+ *               endian negative offset follows
+ * A match may overlap the bytes it produces (LDIR semantics).
+ *
+ * The parse is optimal for this format: the shortest stream wins.
+ *
+ * Modes:
+ *   cdtc_lz in out             raw stream
+ *   cdtc_lz --inplace in out   4-byte header (stream length, extent)
+ *                              then stream, for cdtc_lz_unpack_inplace
+ *   cdtc_lz --sfx in.binamsdos out.ihx
+ *                              self-extracting program: loads where the
+ *                              original loaded, decompresses over itself
+ *                              and jumps to the original run address.
+ *                              A .map next to out.ihx names its run
+ *                              address, so that cdtc_pack can use it.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_INPUT 0x10000
+#define MAX_LITERALS 0x7f
+#define SHORT_MIN 2
+#define SHORT_MAX (0x3f + SHORT_MIN)
+#define SHORT_DISTANCE 256
+#define LONG_MIN 3
+#define LONG_MAX (0x3f + LONG_MIN)
+#define LONG_DISTANCE 0xffff
+#define CHAIN_DEPTH 4096
+#define HASH_SIZE 0x10000
+
+#define AMSDOS_HEADER_SIZE 128
+#define INPLACE_HEADER_SIZE 4
+#define DEFAULT_HIMEM 0xa67f
+
+static const char *progname = "cdtc_lz";
+
+static void
+die (const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start (ap, fmt);
+	fprintf (stderr, "%s: ", progname);
+	vfprintf (stderr, fmt, ap);
+	fputc ('\n', stderr);
+	va_end (ap);
+	exit (1);
+}
+
+static void
+put_le16 (uint8_t *p, unsigned int v)
+{
+	p[0] = v & 0xff;
+	p[1] = (v >> 8) & 0xff;
+}
+
+static unsigned int
+get_le16 (const uint8_t *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+/************************************************************************
+ * Files
+ ************************************************************************/
+
+static uint8_t *
+read_whole_file (const char *filename, unsigned int *length)
+{
+	FILE *f = fopen (filename, "rb");
+	uint8_t *data = NULL;
+	size_t size = 0, got;
+
+	if (f == NULL)
+		die ("%s: %s", filename, strerror (errno));
+	do
+	{
+		data = realloc (data, size + 4096);
+		if (data == NULL)
+			die ("out of memory");
+		got = fread (data + size, 1, 4096, f);
+		size += got;
+	}
+	while (got == 4096);
+	if (ferror (f))
+		die ("%s: %s", filename, strerror (errno));
+	fclose (f);
+	*length = size;
+	return data;
+}
+
+/* Written next to the final name, then renamed. */
+static void
+write_file (const char *filename, const char *text, const uint8_t *data,
+	    unsigned int length)
+{
+	char *tmpname = malloc (strlen (filename) + 5);
+	FILE *f;
+
+	if (tmpname == NULL)
+		die ("out of memory");
+	sprintf (tmpname, "%s.tmp", filename);
+	f = fopen (tmpname, "wb");
+	if (f == NULL)
+		die ("%s: %s", tmpname, strerror (errno));
+	if ((text != NULL && fputs (text, f) == EOF)
+	    || (length != 0 && fwrite (data, length, 1, f) != 1)
+	    || fclose (f) != 0)
+		die ("%s: %s", tmpname, strerror (errno));
+	if (rename (tmpname, filename) != 0)
+		die ("%s: %s", filename, strerror (errno));
+	free (tmpname);
+}
+
+/* Intel hex, 32 bytes per record like the SDCC linker. */
+static void
+write_ihx (const char *filename, const uint8_t *data, unsigned int length,
+	   unsigned int address)
+{
+	char *text = malloc ((length / 32 + 2) * 80);
+	char *p = text;
+	unsigned int offset;
+
+	if (text == NULL)
+		die ("out of memory");
+	for (offset = 0; offset < length; offset += 32)
+	{
+		unsigned int n = length - offset < 32 ? length - offset : 32;
+		unsigned int a = address + offset, sum, i;
+
+		sum = n + (a >> 8) + (a & 0xff);
+		p += sprintf (p, ":%02X%04X00", n, a);
+		for (i = 0; i < n; i++)
+		{
+			p += sprintf (p, "%02X", data[offset + i]);
+			sum += data[offset + i];
+		}
+		p += sprintf (p, "%02X\n", (0x100 - (sum & 0xff)) & 0xff);
+	}
+	strcpy (p, ":00000001FF\n");
+	write_file (filename, text, NULL, 0);
+	free (text);
+}
+
+/************************************************************************
+ * Compression
+ ************************************************************************/
+
+struct choice
+{
+	unsigned int cost;	/* stream bytes from here to the end */
+	uint16_t length;	/* of the literal run or match */
+	uint16_t distance;	/* 0 for literals */
+	uint8_t is_short;	/* match with a one byte offset */
+};
+
+struct stream
+{
+	uint8_t *data;
+	unsigned int length;
+	/* Largest (output position - input position) at a token start.
+	   To decompress in place, the stream must end at least
+	   gap - (original length - stream length) bytes past the output. */
+	int gap;
+};
+
+static void
+compress (const uint8_t *in, unsigned int n, struct stream *s)
+{
+	struct choice *choice = malloc ((n + 1) * sizeof (struct choice));
+	int32_t *head = malloc (HASH_SIZE * sizeof (int32_t));
+	int32_t *prev = malloc ((n + 1) * sizeof (int32_t));
+	uint16_t *short_length = calloc (n + 1, sizeof (uint16_t));
+	uint16_t *short_distance = calloc (n + 1, sizeof (uint16_t));
+	uint16_t *long_length = calloc (n + 1, sizeof (uint16_t));
+	uint16_t *long_distance = calloc (n + 1, sizeof (uint16_t));
+	unsigned int i, j, out, pos;
+
+	if (choice == NULL || head == NULL || prev == NULL || short_length == NULL
+	    || short_distance == NULL || long_length == NULL || long_distance == NULL)
+		die ("out of memory");
+
+	/* Longest matches at each position, with a short and a long
+	   offset, through hash chains on the next two bytes. */
+	for (i = 0; i < HASH_SIZE; i++)
+		head[i] = -1;
+	for (i = 0; i + 1 < n; i++)
+	{
+		unsigned int hash = (in[i] << 8) | in[i + 1];
+		int32_t candidate = head[hash];
+		unsigned int depth = 0;
+
+		while (candidate >= 0 && depth++ < CHAIN_DEPTH)
+		{
+			unsigned int distance = i - candidate, length = 0;
+			unsigned int limit = n - i < LONG_MAX ? n - i : LONG_MAX;
+
+			if (distance > LONG_DISTANCE)
+				break;
+			while (length < limit && in[candidate + length] == in[i + length])
+				length++;
+			if (distance <= SHORT_DISTANCE && length > short_length[i])
+			{
+				short_length[i] = length < SHORT_MAX ? length : SHORT_MAX;
+				short_distance[i] = distance;
+			}
+			if (length > long_length[i])
+			{
+				long_length[i] = length;
+				long_distance[i] = distance;
+			}
+			if (long_length[i] == limit && short_length[i] >= (limit < SHORT_MAX ? limit : SHORT_MAX))
+				break;
+			candidate = prev[candidate];
+		}
+		prev[i] = head[hash];
+		head[hash] = i;
+	}
+
+	/* Cheapest way to encode from each position to the end. */
+	choice[n].cost = 0;
+	for (pos = n; pos-- > 0;)
+	{
+		struct choice best = { (unsigned int) -1, 0, 0, 0 };
+
+		for (j = short_length[pos]; j >= SHORT_MIN; j--)
+			if (2 + choice[pos + j].cost < best.cost)
+			{
+				best.cost = 2 + choice[pos + j].cost;
+				best.length = j;
+				best.distance = short_distance[pos];
+				best.is_short = 1;
+			}
+		for (j = long_length[pos]; j >= LONG_MIN; j--)
+			if (3 + choice[pos + j].cost < best.cost)
+			{
+				best.cost = 3 + choice[pos + j].cost;
+				best.length = j;
+				best.distance = long_distance[pos];
+				best.is_short = 0;
+			}
+		for (j = 1; j <= MAX_LITERALS && pos + j <= n; j++)
+			if (1 + j + choice[pos + j].cost < best.cost)
+			{
+				best.cost = 1 + j + choice[pos + j].cost;
+				best.length = j;
+				best.distance = 0;
+				best.is_short = 0;
+			}
+		choice[pos] = best;
+	}
+
+	s->data = malloc (choice[0].cost + 1);
+	if (s->data == NULL)
+		die ("out of memory");
+	s->gap = 0;
+	for (pos = 0, out = 0; pos < n; pos += choice[pos].length)
+	{
+		const struct choice *c = &choice[pos];
+
+		if ((int) pos - (int) out > s->gap)
+			s->gap = pos - out;
+		if (c->distance == 0)
+		{
+			s->data[out++] = c->length;
+			memcpy (s->data + out, in + pos, c->length);
+			out += c->length;
+		}
+		else if (c->is_short)
+		{
+			s->data[out++] = 0x80 | (c->length - SHORT_MIN);
+			s->data[out++] = (0x10000 - c->distance) & 0xff;
+		}
+		else
+		{
+			s->data[out++] = 0xc0 | (c->length - LONG_MIN);
+			put_le16 (s->data + out, 0x10000 - c->distance);
+			out += 2;
+		}
+	}
+	/* The end token must not be overwritten before it is read. */
+	if ((int) n - (int) out > s->gap)
+		s->gap = n - out;
+	s->data[out++] = 0;
+	s->length = out;
+
+	free (choice);
+	free (head);
+	free (prev);
+	free (short_length);
+	free (short_distance);
+	free (long_length);
+	free (long_distance);
+}
+
+/* Reference decompressor, every stream is checked with it. */
+static unsigned int
+decompress (const uint8_t *in, unsigned int length, uint8_t *out, unsigned int room)
+{
+	unsigned int i = 0, o = 0;
+
+	for (;;)
+	{
+		unsigned int token, count, distance;
+
+		if (i >= length)
+			die ("internal error: stream has no end");
+		token = in[i++];
+		if (token == 0)
+			return o;
+		if (token < 0x80)
+		{
+			count = token;
+			if (i + count > length || o + count > room)
+				die ("internal error: literals overflow");
+			memcpy (out + o, in + i, count);
+			i += count;
+			o += count;
+			continue;
+		}
+		if (token < 0xc0)
+		{
+			count = (token & 0x3f) + SHORT_MIN;
+			distance = 0x100 - in[i++];
+		}
+		else
+		{
+			count = (token & 0x3f) + LONG_MIN;
+			distance = 0x10000 - get_le16 (in + i);
+			i += 2;
+		}
+		if (distance > o || o + count > room)
+			die ("internal error: match out of range");
+		for (; count > 0; count--, o++)
+			out[o] = out[o - distance];
+	}
+}
+
+static void
+compress_checked (const uint8_t *in, unsigned int n, struct stream *s)
+{
+	uint8_t *check = malloc (n + 1);
+
+	if (check == NULL)
+		die ("out of memory");
+	compress (in, n, s);
+	if (decompress (s->data, s->length, check, n) != n || memcmp (check, in, n) != 0)
+		die ("internal error: stream does not decompress to its input");
+	free (check);
+}
+
+/* Bytes past the end of the output where the stream must end, for a
+   forward decompression over itself.  At least min_gap bytes before
+   the stream stay free too. */
+static unsigned int
+inplace_margin (const struct stream *s, unsigned int n, unsigned int min_gap)
+{
+	int margin = s->gap - ((int) n - (int) s->length);
+
+	if (margin < (int) (min_gap + s->length) - (int) n)
+		margin = min_gap + s->length - n;
+	return margin > 0 ? margin : 0;
+}
+
+/************************************************************************
+ * Self-extracting program
+ ************************************************************************/
+
+/* Copies stream and decompressor to the top of the area used, then
+   jumps to the decompressor. */
+static const uint8_t sfx_stub[] = {
+	0x21, 0x00, 0x00,	/* ld hl,#last byte of the decompressor */
+	0x11, 0x00, 0x00,	/* ld de,#its final place */
+	0x01, 0x00, 0x00,	/* ld bc,#stream + decompressor */
+	0xed, 0xb8,		/* lddr */
+	0x21, 0x00, 0x00,	/* ld hl,#stream */
+	0x11, 0x00, 0x00,	/* ld de,#load address */
+	0xc3, 0x00, 0x00,	/* jp decompressor */
+};
+
+#define STUB_SRC_END 1
+#define STUB_DST_END 4
+#define STUB_COUNT 7
+#define STUB_STREAM 12
+#define STUB_LOAD 15
+#define STUB_DECODER 18
+
+/* cdtc_lz_unpack_small from cpclib/cdtc_lz, position independent,
+   ending with a jump to the run address instead of a return. */
+static const uint8_t sfx_decoder[] = {
+	0x06, 0x00,		/*         ld b,#0 */
+	0x7e,			/* token:  ld a,(hl) */
+	0x23,			/*         inc hl */
+	0x87,			/*         add a,a */
+	0x38, 0x09,		/*         jr c,match */
+	0xca, 0x00, 0x00,	/*         jp z,run address */
+	0x0f,			/*         rrca */
+	0x4f,			/*         ld c,a */
+	0xed, 0xb0,		/*         ldir */
+	0x18, 0xf2,		/*         jr token */
+	0x0f,			/* match:  rrca */
+	0x4e,			/*         ld c,(hl) */
+	0x23,			/*         inc hl */
+	0x06, 0xff,		/*         ld b,#0xFF */
+	0xfe, 0x40,		/*         cp #0x40 */
+	0x38, 0x04,		/*         jr c,short */
+	0xd6, 0x3f,		/*         sub #0x3F */
+	0x46,			/*         ld b,(hl) */
+	0x23,			/*         inc hl */
+	0xe5,			/* short:  push hl */
+	0x60,			/*         ld h,b */
+	0x69,			/*         ld l,c */
+	0x19,			/*         add hl,de */
+	0xc6, 0x02,		/*         add a,#2 */
+	0x4f,			/*         ld c,a */
+	0x06, 0x00,		/*         ld b,#0 */
+	0xed, 0xb0,		/*         ldir */
+	0xe1,			/*         pop hl */
+	0x18, 0xd7,		/*         jr token */
+};
+
+#define DECODER_RUN 8
+
+static void
+write_sfx (const char *input, const char *output, unsigned int himem)
+{
+	unsigned int length, load, run, n, margin, size, top;
+	uint8_t *file = read_whole_file (input, &length);
+	uint8_t *program;
+	struct stream s;
+	char *mapname, *dot, map[200];
+	unsigned int i, checksum = 0;
+
+	if (length >= AMSDOS_HEADER_SIZE)
+		for (i = 0; i < 67; i++)
+			checksum += file[i];
+	if (length < AMSDOS_HEADER_SIZE || checksum == 0
+	    || (checksum & 0xffff) != get_le16 (file + 67))
+		die ("%s: no AMSDOS header", input);
+	load = get_le16 (file + 21);
+	n = get_le16 (file + 24);
+	run = get_le16 (file + 26);
+	if (n > length - AMSDOS_HEADER_SIZE)
+		die ("%s: shorter than its AMSDOS header says", input);
+
+	compress_checked (file + AMSDOS_HEADER_SIZE, n, &s);
+	margin = inplace_margin (&s, n, sizeof (sfx_stub));
+	size = sizeof (sfx_stub) + s.length + sizeof (sfx_decoder);
+	top = load + n + margin + sizeof (sfx_decoder) - 1;
+	if (top > himem)
+		die ("%s: decompression would use &%04X-&%04X, above &%04X",
+		     input, load, top, himem);
+
+	program = malloc (size);
+	if (program == NULL)
+		die ("out of memory");
+	memcpy (program, sfx_stub, sizeof (sfx_stub));
+	memcpy (program + sizeof (sfx_stub), s.data, s.length);
+	memcpy (program + sizeof (sfx_stub) + s.length, sfx_decoder, sizeof (sfx_decoder));
+	put_le16 (program + STUB_SRC_END, load + size - 1);
+	put_le16 (program + STUB_DST_END, top);
+	put_le16 (program + STUB_COUNT, s.length + sizeof (sfx_decoder));
+	put_le16 (program + STUB_STREAM, load + n + margin - s.length);
+	put_le16 (program + STUB_LOAD, load);
+	put_le16 (program + STUB_DECODER, load + n + margin);
+	put_le16 (program + sizeof (sfx_stub) + s.length + DECODER_RUN, run);
+
+	write_ihx (output, program, size, load);
+
+	/* aslink map format, as read by cdtc_pack --run. */
+	mapname = malloc (strlen (output) + 5);
+	if (mapname == NULL)
+		die ("out of memory");
+	strcpy (mapname, output);
+	dot = strrchr (mapname, '.');
+	if (dot != NULL && strchr (dot, '/') == NULL)
+		strcpy (dot, ".map");
+	else
+		strcat (mapname, ".map");
+	snprintf (map, sizeof (map), "     %08X  cpc_run_address                    %s\n", load, progname);
+	write_file (mapname, map, NULL, 0);
+
+	printf ("%s: %s: %u -> %u bytes (%u%%), loads and runs at &%04X, uses &%04X-&%04X, then runs &%04X\n",
+		progname, input, n, size, n ? size * 100 / n : 100, load, load, top, run);
+	free (mapname);
+	free (program);
+	free (s.data);
+	free (file);
+}
+
+/************************************************************************
+ * Main
+ ************************************************************************/
+
+static void
+usage (FILE *f)
+{
+	fprintf (f,
+		 "Usage: %s [options] input output\n"
+		 "  -i, --inplace      prefix the stream with the header that\n"
+		 "                     cdtc_lz_unpack_inplace needs\n"
+		 "  -x, --sfx          input is an AMSDOS binary, output is a self-extracting\n"
+		 "                     program (.ihx, with a .map naming its run address)\n"
+		 "  -H, --himem ADDR   highest address the self-extracting program may\n"
+		 "                     use (default &%04X)\n"
+		 "  -d, --decompress   decompress a raw stream\n"
+		 "  -h, --help\n",
+		 progname, DEFAULT_HIMEM);
+}
+
+int
+main (int argc, char **argv)
+{
+	static const struct option options[] = {
+		{"inplace", no_argument, NULL, 'i'},
+		{"sfx", no_argument, NULL, 'x'},
+		{"himem", required_argument, NULL, 'H'},
+		{"decompress", no_argument, NULL, 'd'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0}
+	};
+	int opt, inplace = 0, sfx = 0, unpack = 0;
+	unsigned int himem = DEFAULT_HIMEM, length;
+	const char *input, *output;
+	uint8_t *data;
+	struct stream s;
+
+	while ((opt = getopt_long (argc, argv, "ixH:dh", options, NULL)) != -1)
+	{
+		switch (opt)
+		{
+		case 'i': inplace = 1; break;
+		case 'x': sfx = 1; break;
+		case 'H':
+		{
+			const char *p = optarg;
+			char *end;
+
+			if (*p == '&' || *p == '$' || *p == '#')
+				p++;
+			else if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+				p += 2;
+			himem = strtoul (p, &end, 16);
+			if (*p == '\0' || *end != '\0' || himem > 0xffff)
+				die ("bad address: %s", optarg);
+			break;
+		}
+		case 'd': unpack = 1; break;
+		case 'h': usage (stdout); return 0;
+		default: usage (stderr); return 1;
+		}
+	}
+	if (optind != argc - 2 || inplace + sfx + unpack > 1)
+	{
+		usage (stderr);
+		return 1;
+	}
+	input = argv[optind];
+	output = argv[optind + 1];
+
+	if (sfx)
+	{
+		write_sfx (input, output, himem);
+		return 0;
+	}
+
+	data = read_whole_file (input, &length);
+	if (unpack)
+	{
+		uint8_t *out = malloc (MAX_INPUT);
+
+		if (out == NULL)
+			die ("out of memory");
+		length = decompress (data, length, out, MAX_INPUT);
+		write_file (output, NULL, out, length);
+		free (out);
+		free (data);
+		return 0;
+	}
+
+	if (length > MAX_INPUT)
+		die ("%s: longer than 64K", input);
+	compress_checked (data, length, &s);
+	if (inplace)
+	{
+		uint8_t *file = malloc (INPLACE_HEADER_SIZE + s.length);
+		unsigned int extent = length + inplace_margin (&s, length, INPLACE_HEADER_SIZE);
+
+		if (file == NULL)
+			die ("out of memory");
+		if (extent > 0xffff)
+			die ("%s: extent too large for in-place decompression", input);
+		put_le16 (file, s.length);
+		put_le16 (file + 2, extent);
+		memcpy (file + INPLACE_HEADER_SIZE, s.data, s.length);
+		write_file (output, NULL, file, INPLACE_HEADER_SIZE + s.length);
+		printf ("%s: %s: %u -> %u bytes (%u%%), in-place extent %u bytes\n",
+			progname, input, length, INPLACE_HEADER_SIZE + s.length,
+			length ? (INPLACE_HEADER_SIZE + s.length) * 100 / length : 100, extent);
+		free (file);
+	}
+	else
+	{
+		write_file (output, NULL, s.data, s.length);
+		printf ("%s: %s: %u -> %u bytes (%u%%)\n", progname, input, length,
+			s.length, length ? s.length * 100 / length : 100);
+	}
+	free (s.data);
+	free (data);
+	return 0;
+}
@@ -0,0 +1,1235 @@
+/*
+ * cdtc_pack: turn the .ihx produced by SDCC into the files a CPC can
+ * load, in one process and without temporary files.
+ *
+ * - .bin       raw binary, from lowest to highest address in the .ihx
+ * - .binamsdos same, prefixed with a 128-byte AMSDOS header
+ * - .dsk       standard (not extended) DATA format disc image holding the
+ *              binary with its AMSDOS header, or any list of files given
+ *              with --file.  An existing image is updated in place: files
+ *              keep their blocks and only changed sectors are rewritten.
+ * - .cdt       tape image (TZX format) holding the binary as standard
+ *              CPC firmware blocks, or with --turbo-loader a small loader
+ *              as standard blocks followed by the binary as one block at
+ *              a higher speed (see cpclib/cdtc_turbo)
+ * - .sna       snapshot: a snapshot taken once the CPC has booted, with
+ *              the binary written into its memory and the Z80 about to
+ *              start it through the firmware, as after loading it from
+ *              disc
+ *
+ * The run address is read from the linker .map file: the first symbol
+ * found among those given with --run is used.  --run also accepts a
+ * plain address (&4000, 0x4000 or $4000).
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <getopt.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <utime.h>
+
+#define CPC_MEMORY_SIZE 0x10000
+
+#define AMSDOS_HEADER_SIZE 128
+#define AMSDOS_FILETYPE_BINARY 2
+
+#define DSK_TRACKS 40
+#define DSK_SECTORS_PER_TRACK 9
+#define DSK_SECTOR_SIZE 512
+#define DSK_SECTOR_SIZE_CODE 2
+#define DSK_FIRST_SECTOR_ID 0xc1
+#define DSK_TRACK_INFO_SIZE 0x100
+#define DSK_TRACK_SIZE (DSK_TRACK_INFO_SIZE + DSK_SECTORS_PER_TRACK * DSK_SECTOR_SIZE)
+#define DSK_FILLER 0xe5
+#define DSK_GAP3 0x4e
+#define DSK_BLOCK_SIZE 1024
+#define DSK_BLOCKS (DSK_TRACKS * DSK_SECTORS_PER_TRACK * DSK_SECTOR_SIZE / DSK_BLOCK_SIZE)
+#define DSK_DIR_BLOCKS 2
+#define DSK_DIR_ENTRY_SIZE 32
+#define DSK_DIR_ENTRIES (DSK_DIR_BLOCKS * DSK_BLOCK_SIZE / DSK_DIR_ENTRY_SIZE)
+#define DSK_RECORD_SIZE 128
+#define DSK_RECORDS_PER_EXTENT 128
+#define DSK_BLOCKS_PER_EXTENT 16
+#define DSK_IMAGE_SIZE (DSK_TRACKS * DSK_SECTORS_PER_TRACK * DSK_SECTOR_SIZE)
+
+#define TAPE_BLOCK_SIZE 2048
+#define TAPE_HEADER_SIZE 64
+#define TAPE_SEGMENT_SIZE 256
+#define TAPE_SYNC_HEADER 0x2c
+#define TAPE_SYNC_DATA 0x16
+#define TAPE_TRAILER_SIZE 4
+#define TAPE_PILOT_PULSES 4096
+#define TAPE_PAUSE_MS 1000
+#define TAPE_LAST_PAUSE_MS 2500
+#define TURBO_PILOT_PULSES 2048
+#define TURBO_SYNC 0x16
+/* TZX timings are expressed in Z80 T-states at 3.5MHz. */
+#define TZX_CLOCK 3500000
+
+#define SNA_HEADER_SIZE 0x100
+#define SNA_C 0x13
+#define SNA_HL 0x17
+#define SNA_SP 0x21
+#define SNA_PC 0x23
+#define SNA_RAM_CONFIG 0x41
+#define SNA_DUMP_SIZE 0x6b	/* in KB, 0 if memory is in chunks */
+/* The firmware stack, for the call to MC START PROGRAM, which then
+   resets it. */
+#define SNA_STACK 0xc000
+/* MC START PROGRAM: resets the firmware (screen cleared, mode 1, ROMs
+   off), then jumps to HL, as RUN" does once a binary is loaded. */
+#define FW_MC_START_PROGRAM 0xbd16
+
+static const char *progname = "cdtc_pack";
+
+struct image
+{
+	uint8_t memory[CPC_MEMORY_SIZE];
+	unsigned int load;	/* lowest address */
+	unsigned int length;
+	unsigned int run;
+};
+
+static void
+die (const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start (ap, fmt);
+	fprintf (stderr, "%s: ", progname);
+	vfprintf (stderr, fmt, ap);
+	fputc ('\n', stderr);
+	va_end (ap);
+	exit (1);
+}
+
+static void
+put_le16 (uint8_t *p, unsigned int v)
+{
+	p[0] = v & 0xff;
+	p[1] = (v >> 8) & 0xff;
+}
+
+static void
+put_le24 (uint8_t *p, unsigned int v)
+{
+	p[0] = v & 0xff;
+	p[1] = (v >> 8) & 0xff;
+	p[2] = (v >> 16) & 0xff;
+}
+
+/* Output files are written next to their final name, then renamed, so
+   that an interrupted run never leaves a truncated file behind. */
+
+struct output
+{
+	FILE *f;
+	const char *name;
+	char *tmpname;
+};
+
+static void
+output_open (struct output *o, const char *name)
+{
+	o->name = name;
+	o->tmpname = malloc (strlen (name) + 5);
+	if (o->tmpname == NULL)
+		die ("out of memory");
+	sprintf (o->tmpname, "%s.tmp", name);
+	o->f = fopen (o->tmpname, "wb");
+	if (o->f == NULL)
+		die ("%s: %s", o->tmpname, strerror (errno));
+}
+
+static void
+output_write (struct output *o, const void *data, size_t length)
+{
+	if (length != 0 && fwrite (data, length, 1, o->f) != 1)
+		die ("%s: %s", o->tmpname, strerror (errno));
+}
+
+static void
+output_close (struct output *o)
+{
+	if (fclose (o->f) != 0)
+		die ("%s: %s", o->tmpname, strerror (errno));
+	if (rename (o->tmpname, o->name) != 0)
+		die ("%s: %s", o->name, strerror (errno));
+	free (o->tmpname);
+}
+
+/************************************************************************
+ * Input
+ ************************************************************************/
+
+static int
+hex_value (const char *s, int digits)
+{
+	int v = 0;
+
+	while (digits-- > 0)
+	{
+		int c = *s++;
+
+		v <<= 4;
+		if (c >= '0' && c <= '9')
+			v |= c - '0';
+		else if (c >= 'A' && c <= 'F')
+			v |= c - 'A' + 10;
+		else if (c >= 'a' && c <= 'f')
+			v |= c - 'a' + 10;
+		else
+			return -1;
+	}
+	return v;
+}
+
+static void
+load_ihx (struct image *img, const char *filename)
+{
+	char line[600];
+	unsigned int lineno = 0, lowest = CPC_MEMORY_SIZE, highest = 0;
+	FILE *f = fopen (filename, "r");
+
+	if (f == NULL)
+		die ("%s: %s", filename, strerror (errno));
+
+	memset (img->memory, 0, sizeof (img->memory));
+
+	while (fgets (line, sizeof (line), f) != NULL)
+	{
+		int count, address, type, i, sum;
+
+		lineno++;
+		if (line[0] != ':')
+			continue;
+		count = hex_value (line + 1, 2);
+		address = hex_value (line + 3, 4);
+		type = hex_value (line + 7, 2);
+		if (count < 0 || address < 0 || type < 0
+		    || strlen (line) < (size_t) (11 + 2 * count))
+			die ("%s:%u: malformed record", filename, lineno);
+
+		sum = count + (address >> 8) + (address & 0xff) + type;
+		for (i = 0; i <= count; i++)
+		{
+			int byte = hex_value (line + 9 + 2 * i, 2);
+
+			if (byte < 0)
+				die ("%s:%u: malformed record", filename, lineno);
+			sum += byte;
+		}
+		if ((sum & 0xff) != 0)
+			die ("%s:%u: bad checksum", filename, lineno);
+
+		if (type == 1)
+			break;
+		if (type != 0)
+			die ("%s:%u: unsupported record type %02x", filename, lineno, type);
+
+		for (i = 0; i < count; i++)
+		{
+			unsigned int a = address + i;
+
+			if (a >= CPC_MEMORY_SIZE)
+				die ("%s:%u: data beyond 64K", filename, lineno);
+			img->memory[a] = hex_value (line + 9 + 2 * i, 2);
+			if (a < lowest)
+				lowest = a;
+			if (a > highest)
+				highest = a;
+		}
+	}
+	fclose (f);
+
+	if (lowest == CPC_MEMORY_SIZE)
+		die ("%s: no data", filename);
+	img->load = lowest;
+	img->length = highest - lowest + 1;
+}
+
+static int
+parse_address (const char *s, unsigned int *value)
+{
+	char *end;
+	unsigned long v;
+
+	if (s[0] == '&' || s[0] == '$' || s[0] == '#')
+		s++;
+	else if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+		s += 2;
+	else
+		return 0;
+	errno = 0;
+	v = strtoul (s, &end, 16);
+	if (*s == '\0' || *end != '\0' || errno != 0 || v >= CPC_MEMORY_SIZE)
+		return 0;
+	*value = v;
+	return 1;
+}
+
+/* Look up a global symbol in an aslink map file.  Symbol lines look
+   like "     00004000  _main      main", possibly with an area letter
+   in front ("C:   00004000  _main"). */
+static int
+map_lookup (const char *mapname, const char *symbol, unsigned int *value)
+{
+	char line[512];
+	FILE *f = fopen (mapname, "r");
+	int found = 0;
+
+	if (f == NULL)
+		die ("%s: %s", mapname, strerror (errno));
+
+	while (!found && fgets (line, sizeof (line), f) != NULL)
+	{
+		char *tok[3];
+		int n = 0;
+		char *p = strtok (line, " \t\r\n");
+
+		while (p != NULL && n < 3)
+		{
+			tok[n++] = p;
+			p = strtok (NULL, " \t\r\n");
+		}
+		if (n >= 1 && strlen (tok[0]) == 2 && tok[0][1] == ':')
+			memmove (tok, tok + 1, --n * sizeof (tok[0]));
+		if (n >= 2 && strcmp (tok[1], symbol) == 0
+		    && strlen (tok[0]) == 8
+		    && strspn (tok[0], "0123456789ABCDEFabcdef") == 8)
+		{
+			*value = strtoul (tok[0], NULL, 16) & 0xffff;
+			found = 1;
+		}
+	}
+	fclose (f);
+	return found;
+}
+
+static void
+find_run_address (struct image *img, const char *mapname,
+		  char **candidates, int ncandidates)
+{
+	int i;
+
+	for (i = 0; i < ncandidates; i++)
+	{
+		if (parse_address (candidates[i], &img->run))
+			return;
+		if (mapname != NULL && map_lookup (mapname, candidates[i], &img->run))
+			return;
+	}
+	fprintf (stderr, "%s: cannot figure out run address, tried:", progname);
+	for (i = 0; i < ncandidates; i++)
+		fprintf (stderr, " %s", candidates[i]);
+	fprintf (stderr, "%s\n", mapname ? "" : " (no map file given)");
+	exit (1);
+}
+
+/************************************************************************
+ * AMSDOS
+ ************************************************************************/
+
+/* CP/M style name: 8 characters, 3 characters extension, upper case,
+   space padded.  The extension is taken from the name unless ext is
+   given. */
+static void
+make_disc_name (uint8_t out[11], const char *name, const char *ext)
+{
+	const char *base = strrchr (name, '/');
+	const char *dot;
+	int i;
+
+	base = base ? base + 1 : name;
+	dot = strchr (base, '.');
+	if (ext == NULL)
+		ext = dot ? dot + 1 : "";
+	memset (out, ' ', 11);
+	for (i = 0; i < 8 && base[i] != '\0' && base + i != dot; i++)
+	{
+		int c = toupper ((unsigned char) base[i]);
+
+		out[i] = (isalnum (c) || c == '_' || c == '-') ? c : '_';
+	}
+	for (i = 0; i < 3 && ext[i] != '\0' && ext[i] != '.'; i++)
+	{
+		int c = toupper ((unsigned char) ext[i]);
+
+		out[8 + i] = (isalnum (c) || c == '_' || c == '-') ? c : '_';
+	}
+}
+
+static unsigned int
+amsdos_checksum (const uint8_t header[AMSDOS_HEADER_SIZE])
+{
+	unsigned int i, checksum = 0;
+
+	for (i = 0; i < 67; i++)
+		checksum += header[i];
+	return checksum & 0xffff;
+}
+
+static int
+has_amsdos_header (const uint8_t *data, unsigned int length)
+{
+	return length >= AMSDOS_HEADER_SIZE
+		&& amsdos_checksum (data) == (unsigned int) (data[67] | (data[68] << 8))
+		&& amsdos_checksum (data) != 0;
+}
+
+static void
+make_amsdos_header (uint8_t header[AMSDOS_HEADER_SIZE], const uint8_t name[11],
+		    unsigned int load, unsigned int length, unsigned int run)
+{
+	memset (header, 0, AMSDOS_HEADER_SIZE);
+	memcpy (header + 1, name, 11);
+	header[18] = AMSDOS_FILETYPE_BINARY;
+	put_le16 (header + 19, length);
+	put_le16 (header + 21, load);
+	header[23] = 0xff;
+	put_le16 (header + 24, length);
+	put_le16 (header + 26, run);
+	put_le24 (header + 64, length);
+	put_le16 (header + 67, amsdos_checksum (header));
+}
+
+/************************************************************************
+ * Files for the disc image
+ ************************************************************************/
+
+/* What ends up in a disc file, AMSDOS header included if any. */
+struct disc_file
+{
+	const char *path;
+	uint8_t name[11];
+	uint8_t *content;
+	unsigned int length;
+	uint8_t padding;	/* for the end of the last record */
+};
+
+static uint8_t *
+read_whole_file (const char *filename, unsigned int *length)
+{
+	FILE *f = fopen (filename, "rb");
+	uint8_t *data = NULL;
+	size_t size = 0, got;
+
+	if (f == NULL)
+		die ("%s: %s", filename, strerror (errno));
+	do
+	{
+		data = realloc (data, size + 4096);
+		if (data == NULL)
+			die ("out of memory");
+		got = fread (data + size, 1, 4096, f);
+		size += got;
+	}
+	while (got == 4096);
+	if (ferror (f))
+		die ("%s: %s", filename, strerror (errno));
+	fclose (f);
+	*length = size;
+	return data;
+}
+
+/* A file specification is "path[:key=value]..." with keys:
+     name=NAME.EXT  name on disc (default: from path)
+     load=ADDR      load address, for files without AMSDOS header (not
+                    for .ihx, which give their own)
+     exec=ADDR      run address (default: load address, or for .ihx
+                    the run symbols looked up in the .map next to it)
+     raw            store the file as is, without AMSDOS header
+   Files that already carry an AMSDOS header are stored as is. */
+static void
+load_disc_file (struct disc_file *df, const char *spec,
+		char **run, int nrun)
+{
+	char *copy = strdup (spec);
+	char *path, *option, *name = NULL;
+	unsigned int load = 0, exec = 0;
+	int has_load = 0, has_exec = 0, raw = 0;
+	size_t pathlen;
+
+	if (copy == NULL)
+		die ("out of memory");
+	path = strtok (copy, ":");
+	if (path == NULL)
+		die ("empty file specification");
+	while ((option = strtok (NULL, ":")) != NULL)
+	{
+		if (strncmp (option, "name=", 5) == 0)
+			name = option + 5;
+		else if (strncmp (option, "load=", 5) == 0 && parse_address (option + 5, &load))
+			has_load = 1;
+		else if (strncmp (option, "exec=", 5) == 0 && parse_address (option + 5, &exec))
+			has_exec = 1;
+		else if (strcmp (option, "raw") == 0)
+			raw = 1;
+		else
+			die ("%s: bad option \"%s\"", spec, option);
+	}
+
+	df->path = path;
+	pathlen = strlen (path);
+	if (pathlen > 4 && strcmp (path + pathlen - 4, ".ihx") == 0)
+	{
+		static struct image img;
+		char *mapname = strdup (path);
+		FILE *map;
+
+		if (has_load)
+			die ("%s: load= does not apply to .ihx, loaded at their own address", spec);
+		if (mapname == NULL)
+			die ("out of memory");
+		strcpy (mapname + pathlen - 4, ".map");
+		map = fopen (mapname, "r");
+		if (map != NULL)
+			fclose (map);
+		load_ihx (&img, path);
+		if (has_exec)
+			img.run = exec;
+		else
+			find_run_address (&img, map ? mapname : NULL, run, nrun);
+		free (mapname);
+		make_disc_name (df->name, name ? name : path, name ? NULL : "BIN");
+		df->length = AMSDOS_HEADER_SIZE + img.length;
+		df->content = malloc (df->length);
+		if (df->content == NULL)
+			die ("out of memory");
+		make_amsdos_header (df->content, df->name, img.load, img.length, img.run);
+		memcpy (df->content + AMSDOS_HEADER_SIZE, img.memory + img.load, img.length);
+		return;
+	}
+
+	make_disc_name (df->name, name ? name : path, NULL);
+	df->content = read_whole_file (path, &df->length);
+	if (raw)
+	{
+		/* Headerless files are read as ASCII, up to the first ^Z. */
+		df->padding = 0x1a;
+		return;
+	}
+	if (has_amsdos_header (df->content, df->length) && !has_load && !has_exec)
+		return;
+
+	if (df->length > 0xffff)
+		die ("%s: too long for an AMSDOS binary file", path);
+	df->content = realloc (df->content, df->length + AMSDOS_HEADER_SIZE);
+	if (df->content == NULL)
+		die ("out of memory");
+	memmove (df->content + AMSDOS_HEADER_SIZE, df->content, df->length);
+	make_amsdos_header (df->content, df->name, load, df->length, has_exec ? exec : load);
+	df->length += AMSDOS_HEADER_SIZE;
+}
+
+/************************************************************************
+ * Outputs
+ ************************************************************************/
+
+static void
+write_bin (const struct image *img, const char *filename,
+	   const uint8_t *header)
+{
+	struct output o;
+
+	output_open (&o, filename);
+	if (header != NULL)
+		output_write (&o, header, AMSDOS_HEADER_SIZE);
+	output_write (&o, img->memory + img->load, img->length);
+	output_close (&o);
+}
+
+/* Physical order of sectors on a track, as formatted by AMSDOS. */
+static const uint8_t dsk_interleave[DSK_SECTORS_PER_TRACK] =
+	{ 0, 5, 1, 6, 2, 7, 3, 8, 4 };
+
+/* Offset in the .dsk file of a sector, counted in logical order. */
+static long
+dsk_sector_offset (unsigned int sector)
+{
+	unsigned int track = sector / DSK_SECTORS_PER_TRACK;
+	unsigned int id = sector % DSK_SECTORS_PER_TRACK, pos;
+
+	for (pos = 0; dsk_interleave[pos] != id; pos++)
+		;
+	return 0x100 + (long) track * DSK_TRACK_SIZE + DSK_TRACK_INFO_SIZE
+		+ (long) pos * DSK_SECTOR_SIZE;
+}
+
+static void
+make_dsk_headers (uint8_t disc_info[0x100], uint8_t info[DSK_TRACKS][DSK_TRACK_INFO_SIZE])
+{
+	unsigned int t, s;
+
+	memset (disc_info, 0, 0x100);
+	memcpy (disc_info, "MV - CPCEMU Disk-File\r\nDisk-Info\r\n", 34);
+	memcpy (disc_info + 0x22, "cdtc_pack", 9);
+	disc_info[0x30] = DSK_TRACKS;
+	disc_info[0x31] = 1;
+	put_le16 (disc_info + 0x32, DSK_TRACK_SIZE);
+
+	for (t = 0; t < DSK_TRACKS; t++)
+	{
+		memset (info[t], 0, DSK_TRACK_INFO_SIZE);
+		memcpy (info[t], "Track-Info\r\n", 12);
+		info[t][0x10] = t;
+		info[t][0x14] = DSK_SECTOR_SIZE_CODE;
+		info[t][0x15] = DSK_SECTORS_PER_TRACK;
+		info[t][0x16] = DSK_GAP3;
+		info[t][0x17] = DSK_FILLER;
+		for (s = 0; s < DSK_SECTORS_PER_TRACK; s++)
+		{
+			uint8_t *sector_info = info[t] + 0x18 + 8 * s;
+
+			sector_info[0] = t;
+			sector_info[2] = DSK_FIRST_SECTOR_ID + dsk_interleave[s];
+			sector_info[3] = DSK_SECTOR_SIZE_CODE;
+		}
+	}
+}
+
+/* Read an image previously written with the same geometry, in logical
+   sector order.  Anything else (missing, other format or interleave)
+   returns 0 and the image is written from scratch. */
+static int
+read_dsk (const char *filename, uint8_t disc[DSK_IMAGE_SIZE])
+{
+	static uint8_t disc_info[0x100], info[DSK_TRACKS][DSK_TRACK_INFO_SIZE];
+	uint8_t buffer[DSK_TRACK_SIZE];
+	FILE *f = fopen (filename, "rb");
+	unsigned int t, s;
+	int ok = 0;
+
+	if (f == NULL)
+		return 0;
+	make_dsk_headers (disc_info, info);
+	if (fread (buffer, 0x100, 1, f) == 1
+	    && memcmp (buffer, disc_info, 0x22) == 0
+	    && memcmp (buffer + 0x30, disc_info + 0x30, 4) == 0)
+	{
+		ok = 1;
+		for (t = 0; ok && t < DSK_TRACKS; t++)
+		{
+			if (fread (buffer, DSK_TRACK_SIZE, 1, f) != 1
+			    || memcmp (buffer, info[t], 0x18 + 8 * DSK_SECTORS_PER_TRACK) != 0)
+				ok = 0;
+			for (s = 0; ok && s < DSK_SECTORS_PER_TRACK; s++)
+				memcpy (disc + (t * DSK_SECTORS_PER_TRACK + dsk_interleave[s]) * DSK_SECTOR_SIZE,
+					buffer + DSK_TRACK_INFO_SIZE + s * DSK_SECTOR_SIZE, DSK_SECTOR_SIZE);
+		}
+	}
+	fclose (f);
+	return ok;
+}
+
+static uint8_t *
+dsk_block (uint8_t disc[DSK_IMAGE_SIZE], unsigned int block)
+{
+	return disc + block * DSK_BLOCK_SIZE;
+}
+
+static unsigned int
+blocks_for (unsigned int length)
+{
+	return (length + DSK_BLOCK_SIZE - 1) / DSK_BLOCK_SIZE;
+}
+
+/* Blocks of a file in a directory, in extent order. */
+static unsigned int
+dsk_file_blocks (const uint8_t disc[DSK_IMAGE_SIZE], const uint8_t name[11],
+		 uint8_t blocks[DSK_BLOCKS])
+{
+	unsigned int count = 0, e, b;
+
+	for (e = 0; e < DSK_DIR_ENTRIES; e++)
+	{
+		const uint8_t *entry = disc + e * DSK_DIR_ENTRY_SIZE;
+		unsigned int extent = entry[12];
+
+		if (entry[0] != 0 || memcmp (entry + 1, name, 11) != 0)
+			continue;
+		for (b = 0; b < DSK_BLOCKS_PER_EXTENT; b++)
+		{
+			unsigned int index = extent * DSK_BLOCKS_PER_EXTENT + b;
+			unsigned int block = entry[16 + b];
+
+			if (block >= DSK_DIR_BLOCKS && block < DSK_BLOCKS && index < DSK_BLOCKS)
+			{
+				blocks[index] = block;
+				if (index + 1 > count)
+					count = index + 1;
+			}
+		}
+	}
+	return count;
+}
+
+/* Lay out files on a DATA disc.  When the image already exists, each
+   file keeps the blocks it had as far as it still needs them, and only
+   sectors whose content changed are rewritten in place. */
+static void
+write_dsk (const char *filename, const struct disc_file *files, unsigned int nfiles)
+{
+	static uint8_t old[DSK_IMAGE_SIZE], disc[DSK_IMAGE_SIZE];
+	static uint8_t disc_info[0x100], info[DSK_TRACKS][DSK_TRACK_INFO_SIZE];
+	static uint8_t blocks[DSK_DIR_ENTRIES][DSK_BLOCKS];
+	uint8_t used[DSK_BLOCKS];
+	unsigned int kept[DSK_DIR_ENTRIES];
+	unsigned int f, b, e, s, entries = 0, rewritten = 0;
+	int incremental = read_dsk (filename, old);
+
+	if (nfiles > DSK_DIR_ENTRIES)
+		die ("%s: too many files", filename);
+	for (f = 0; f < nfiles; f++)
+		for (b = 0; b < f; b++)
+			if (memcmp (files[f].name, files[b].name, 11) == 0)
+				die ("%s: %s and %s have the same name on disc",
+				     filename, files[b].path, files[f].path);
+
+	if (incremental)
+		memcpy (disc, old, sizeof (disc));
+	else
+		memset (disc, DSK_FILLER, sizeof (disc));
+
+	/* Keep the blocks each file already had, as far as still needed. */
+	memset (used, 0, sizeof (used));
+	for (b = 0; b < DSK_DIR_BLOCKS; b++)
+		used[b] = 1;
+	for (f = 0; f < nfiles; f++)
+	{
+		unsigned int need = blocks_for (files[f].length);
+
+		kept[f] = incremental ? dsk_file_blocks (old, files[f].name, blocks[f]) : 0;
+		if (kept[f] > need)
+			kept[f] = need;
+		for (b = 0; b < kept[f]; b++)
+		{
+			if (blocks[f][b] == 0 || used[blocks[f][b]])
+			{
+				kept[f] = b;
+				break;
+			}
+			used[blocks[f][b]] = 1;
+		}
+	}
+
+	/* Then give new blocks to files that grew or are new. */
+	for (f = 0; f < nfiles; f++)
+	{
+		unsigned int need = blocks_for (files[f].length), next = DSK_DIR_BLOCKS;
+		unsigned int records = (files[f].length + DSK_RECORD_SIZE - 1) / DSK_RECORD_SIZE;
+
+		for (b = kept[f]; b < need; b++)
+		{
+			while (next < DSK_BLOCKS && used[next])
+				next++;
+			if (next == DSK_BLOCKS)
+				die ("%s: disc full while adding %s", filename, files[f].path);
+			used[next] = 1;
+			blocks[f][b] = next;
+		}
+		for (b = 0; b < need; b++)
+		{
+			unsigned int n = files[f].length - b * DSK_BLOCK_SIZE;
+			uint8_t *block = dsk_block (disc, blocks[f][b]);
+
+			if (n > DSK_BLOCK_SIZE)
+				n = DSK_BLOCK_SIZE;
+			memset (block, DSK_FILLER, DSK_BLOCK_SIZE);
+			memcpy (block, files[f].content + b * DSK_BLOCK_SIZE, n);
+		}
+		/* Pad the last record rather than leave filler. */
+		if (files[f].length % DSK_RECORD_SIZE != 0)
+		{
+			unsigned int last = files[f].length - 1;
+			uint8_t *block = dsk_block (disc, blocks[f][last / DSK_BLOCK_SIZE]);
+
+			memset (block + last % DSK_BLOCK_SIZE + 1, files[f].padding,
+				records * DSK_RECORD_SIZE - files[f].length);
+		}
+	}
+
+	/* Directory, one entry per 16K extent, in the order files were given. */
+	memset (disc, DSK_FILLER, DSK_DIR_BLOCKS * DSK_BLOCK_SIZE);
+	for (f = 0; f < nfiles; f++)
+	{
+		unsigned int records = (files[f].length + DSK_RECORD_SIZE - 1) / DSK_RECORD_SIZE;
+		unsigned int need = blocks_for (files[f].length);
+		unsigned int extents = (records + DSK_RECORDS_PER_EXTENT - 1) / DSK_RECORDS_PER_EXTENT;
+
+		if (extents == 0)
+			extents = 1;
+		for (e = 0; e < extents; e++)
+		{
+			uint8_t *entry = disc + entries * DSK_DIR_ENTRY_SIZE;
+			unsigned int rc = records - e * DSK_RECORDS_PER_EXTENT;
+
+			if (entries++ == DSK_DIR_ENTRIES)
+				die ("%s: directory full while adding %s", filename, files[f].path);
+			memset (entry, 0, DSK_DIR_ENTRY_SIZE);
+			memcpy (entry + 1, files[f].name, 11);
+			entry[12] = e;
+			entry[15] = rc > DSK_RECORDS_PER_EXTENT ? DSK_RECORDS_PER_EXTENT : rc;
+			for (b = 0; b < DSK_BLOCKS_PER_EXTENT; b++)
+				if (e * DSK_BLOCKS_PER_EXTENT + b < need)
+					entry[16 + b] = blocks[f][e * DSK_BLOCKS_PER_EXTENT + b];
+		}
+	}
+
+	if (incremental)
+	{
+		FILE *out = fopen (filename, "r+b");
+
+		if (out == NULL)
+			die ("%s: %s", filename, strerror (errno));
+		for (s = 0; s < DSK_IMAGE_SIZE / DSK_SECTOR_SIZE; s++)
+		{
+			const uint8_t *sector = disc + s * DSK_SECTOR_SIZE;
+
+			if (memcmp (sector, old + s * DSK_SECTOR_SIZE, DSK_SECTOR_SIZE) == 0)
+				continue;
+			if (fseek (out, dsk_sector_offset (s), SEEK_SET) != 0
+			    || fwrite (sector, DSK_SECTOR_SIZE, 1, out) != 1)
+				die ("%s: %s", filename, strerror (errno));
+			rewritten++;
+		}
+		if (fclose (out) != 0)
+			die ("%s: %s", filename, strerror (errno));
+		/* Let make see the image as up to date even if nothing changed. */
+		if (rewritten == 0 && utime (filename, NULL) != 0)
+			die ("%s: %s", filename, strerror (errno));
+	}
+	else
+	{
+		struct output o;
+		unsigned int t;
+
+		make_dsk_headers (disc_info, info);
+		output_open (&o, filename);
+		output_write (&o, disc_info, sizeof (disc_info));
+		for (t = 0; t < DSK_TRACKS; t++)
+		{
+			output_write (&o, info[t], DSK_TRACK_INFO_SIZE);
+			for (s = 0; s < DSK_SECTORS_PER_TRACK; s++)
+				output_write (&o, disc + (t * DSK_SECTORS_PER_TRACK + dsk_interleave[s])
+					      * DSK_SECTOR_SIZE, DSK_SECTOR_SIZE);
+		}
+		output_close (&o);
+		rewritten = DSK_IMAGE_SIZE / DSK_SECTOR_SIZE;
+	}
+	printf ("%s: %s: %u file(s), %u of %u sectors written\n", progname, filename,
+		nfiles, rewritten, DSK_IMAGE_SIZE / DSK_SECTOR_SIZE);
+}
+
+/* CRC of CPC tape segments: CCITT polynomial, initial value &FFFF, result
+   inverted, stored high byte first. */
+static unsigned int
+tape_crc (const uint8_t *data, unsigned int length)
+{
+	unsigned int crc = 0xffff, i;
+	int bit;
+
+	for (i = 0; i < length; i++)
+	{
+		crc ^= data[i] << 8;
+		for (bit = 0; bit < 8; bit++)
+			crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+	}
+	return ~crc & 0xffff;
+}
+
+/* Data as a TZX "turbo speed data" block, with the pulses of the
+   firmware: a zero bit lasts 2/3 of the average bit time, a one bit
+   twice as long; the pilot is made of one bits, the sync of a zero bit.
+   Returns the time the block takes to play, in milliseconds. */
+static unsigned int
+tzx_write_data (struct output *o, unsigned int baud, unsigned int pilot_pulses,
+		const uint8_t *data, unsigned int size, unsigned int pause)
+{
+	unsigned int zero_pulse = (TZX_CLOCK + 3 * baud / 2) / (3 * baud);
+	unsigned int one_pulse = 2 * zero_pulse;
+	unsigned long long t = (unsigned long long) pilot_pulses * one_pulse + 2 * zero_pulse;
+	unsigned int i;
+	uint8_t block[0x13];
+
+	for (i = 0; i < size; i++)
+	{
+		unsigned int ones = 0, byte;
+
+		for (byte = data[i]; byte != 0; byte >>= 1)
+			ones += byte & 1;
+		t += 2ULL * (ones * one_pulse + (8 - ones) * zero_pulse);
+	}
+
+	block[0] = 0x11;
+	put_le16 (block + 0x01, one_pulse);	/* pilot */
+	put_le16 (block + 0x03, zero_pulse);	/* sync 1 */
+	put_le16 (block + 0x05, zero_pulse);	/* sync 2 */
+	put_le16 (block + 0x07, zero_pulse);
+	put_le16 (block + 0x09, one_pulse);
+	put_le16 (block + 0x0b, pilot_pulses);
+	block[0x0d] = 8;
+	put_le16 (block + 0x0e, pause);
+	put_le24 (block + 0x10, size);
+	output_write (o, block, sizeof (block));
+	output_write (o, data, size);
+	return (unsigned int) ((t * 1000 + TZX_CLOCK / 2) / TZX_CLOCK) + pause;
+}
+
+/* One firmware record: sync byte, 256-byte segments each followed by
+   its CRC, trailer. */
+static unsigned int
+cdt_write_record (struct output *o, unsigned int baud, uint8_t sync,
+		  const uint8_t *data, unsigned int length, unsigned int pause)
+{
+	static uint8_t record[1 + (TAPE_BLOCK_SIZE / TAPE_SEGMENT_SIZE) * (TAPE_SEGMENT_SIZE + 2)
+			      + TAPE_TRAILER_SIZE];
+	unsigned int segments = (length + TAPE_SEGMENT_SIZE - 1) / TAPE_SEGMENT_SIZE;
+	unsigned int size = 0, s;
+
+	record[size++] = sync;
+	for (s = 0; s < segments; s++)
+	{
+		uint8_t *segment = record + size;
+		unsigned int crc;
+		unsigned int n = length - s * TAPE_SEGMENT_SIZE;
+
+		if (n > TAPE_SEGMENT_SIZE)
+			n = TAPE_SEGMENT_SIZE;
+		memset (segment, 0, TAPE_SEGMENT_SIZE);
+		memcpy (segment, data + s * TAPE_SEGMENT_SIZE, n);
+		crc = tape_crc (segment, TAPE_SEGMENT_SIZE);
+		size += TAPE_SEGMENT_SIZE;
+		record[size++] = crc >> 8;
+		record[size++] = crc & 0xff;
+	}
+	memset (record + size, 0xff, TAPE_TRAILER_SIZE);
+	size += TAPE_TRAILER_SIZE;
+
+	return tzx_write_data (o, baud, TAPE_PILOT_PULSES, record, size, pause);
+}
+
+/* A binary file as the firmware writes it: 2K blocks, each one a header
+   record followed by a data record. */
+static unsigned int
+cdt_write_file (struct output *o, const struct image *img, const char *name,
+		unsigned int baud)
+{
+	const char *base = strrchr (name, '/');
+	unsigned int offset = 0, blockno = 1, ms = 0;
+
+	base = base ? base + 1 : name;
+	do
+	{
+		uint8_t header[TAPE_SEGMENT_SIZE];
+		unsigned int n = img->length - offset;
+		int last;
+		size_t i;
+
+		if (n > TAPE_BLOCK_SIZE)
+			n = TAPE_BLOCK_SIZE;
+		last = (offset + n == img->length);
+
+		memset (header, 0, sizeof (header));
+		for (i = 0; i < 16 && base[i] != '\0' && base[i] != '.'; i++)
+			header[i] = toupper ((unsigned char) base[i]);
+		header[16] = blockno;
+		header[17] = last ? 0xff : 0;
+		header[18] = AMSDOS_FILETYPE_BINARY;
+		put_le16 (header + 19, n);
+		put_le16 (header + 21, img->load + offset);
+		header[23] = offset == 0 ? 0xff : 0;
+		put_le16 (header + 24, img->length);
+		put_le16 (header + 26, img->run);
+
+		ms += cdt_write_record (o, baud, TAPE_SYNC_HEADER, header, TAPE_HEADER_SIZE,
+					TAPE_PAUSE_MS);
+		ms += cdt_write_record (o, baud, TAPE_SYNC_DATA, img->memory + img->load + offset, n,
+					last ? TAPE_LAST_PAUSE_MS : TAPE_PAUSE_MS);
+		offset += n;
+		blockno++;
+	}
+	while (offset < img->length);
+	return ms;
+}
+
+/* The program as one block for cdtc_turbo_loader: sync byte, program,
+   then the byte that makes the XOR of all of them zero. */
+static unsigned int
+cdt_write_turbo (struct output *o, const struct image *img, unsigned int baud)
+{
+	uint8_t *data = malloc (img->length + 2);
+	unsigned int i, ms;
+	uint8_t check = TURBO_SYNC;
+
+	if (data == NULL)
+		die ("out of memory");
+	data[0] = TURBO_SYNC;
+	for (i = 0; i < img->length; i++)
+	{
+		data[1 + i] = img->memory[img->load + i];
+		check ^= data[1 + i];
+	}
+	data[1 + img->length] = check;
+	ms = tzx_write_data (o, baud, TURBO_PILOT_PULSES, data, img->length + 2,
+			     TAPE_LAST_PAUSE_MS);
+	free (data);
+	return ms;
+}
+
+/* Fill in the parameters of cdtc_turbo_loader, linked in loader with
+   its map file next to it, so that it loads and runs img. */
+static void
+setup_turbo_loader (struct image *loader, const char *filename, const struct image *img)
+{
+	static const char *const params[] = {
+		"cdtc_turbo_load", "cdtc_turbo_length", "cdtc_turbo_run"
+	};
+	unsigned int values[3], address, i;
+	char *mapname = malloc (strlen (filename) + 5);
+	char *dot;
+
+	if (mapname == NULL)
+		die ("out of memory");
+	strcpy (mapname, filename);
+	dot = strrchr (mapname, '.');
+	if (dot != NULL && strchr (dot, '/') == NULL)
+		strcpy (dot, ".map");
+	else
+		strcat (mapname, ".map");
+
+	load_ihx (loader, filename);
+	if (!map_lookup (mapname, "cdtc_turbo_loader", &loader->run))
+		die ("%s: no cdtc_turbo_loader symbol", mapname);
+	if (img->load < loader->load + loader->length && loader->load < img->load + img->length)
+		die ("%s: program &%04X-&%04X overlaps the turbo loader at &%04X-&%04X",
+		     filename, img->load, img->load + img->length - 1,
+		     loader->load, loader->load + loader->length - 1);
+
+	values[0] = img->load;
+	values[1] = img->length;
+	values[2] = img->run;
+	for (i = 0; i < 3; i++)
+	{
+		if (!map_lookup (mapname, params[i], &address))
+			die ("%s: no %s symbol", mapname, params[i]);
+		if (address < loader->load || address + 2 > loader->load + loader->length)
+			die ("%s: %s is outside the loader", mapname, params[i]);
+		put_le16 (loader->memory + address, values[i]);
+	}
+	free (mapname);
+}
+
+static void
+write_cdt (const struct image *img, const char *filename, const char *name,
+	   unsigned int baud, const struct image *loader, unsigned int turbo_baud)
+{
+	unsigned int ms;
+	struct output o;
+
+	output_open (&o, filename);
+	output_write (&o, "ZXTape!\x1a\x01\x0d", 10);
+	if (loader != NULL)
+	{
+		ms = cdt_write_file (&o, loader, name, baud);
+		ms += cdt_write_turbo (&o, img, turbo_baud);
+	}
+	else
+		ms = cdt_write_file (&o, img, name, baud);
+	output_close (&o);
+
+	printf ("%s: %s: %u.%u seconds of tape\n", progname, filename, ms / 1000, ms % 1000 / 100);
+}
+
+/* Write the program into the memory of a copy of BOOT, a snapshot saved
+   by cap32 at the BASIC prompt.  The Z80 then calls MC START PROGRAM
+   with the run address, as RUN" does once the program is loaded from
+   disc: the program finds the screen and the firmware as after RUN",
+   without the seconds that typing it and loading take. */
+static void
+write_sna (const struct image *img, const char *filename, const char *boot)
+{
+	unsigned int length;
+	uint8_t *sna = read_whole_file (boot, &length);
+	struct output o;
+
+	if (length < SNA_HEADER_SIZE || memcmp (sna, "MV - SNA", 8) != 0)
+		die ("%s: not a snapshot", boot);
+	if (sna[SNA_DUMP_SIZE] < 64 || length < SNA_HEADER_SIZE + CPC_MEMORY_SIZE)
+		die ("%s: no uncompressed 64K memory dump", boot);
+	if (img->load + img->length > SNA_STACK - 2)
+		die ("%s: program overlaps the stack at &%04X", filename, SNA_STACK - 2);
+
+	memcpy (sna + SNA_HEADER_SIZE + img->load, img->memory + img->load, img->length);
+	put_le16 (sna + SNA_HL, img->run);
+	sna[SNA_C] = 0;
+	put_le16 (sna + SNA_SP, SNA_STACK);
+	put_le16 (sna + SNA_PC, FW_MC_START_PROGRAM);
+	sna[SNA_RAM_CONFIG] = 0;
+
+	output_open (&o, filename);
+	output_write (&o, sna, length);
+	output_close (&o);
+	free (sna);
+}
+
+/************************************************************************
+ * Main
+ ************************************************************************/
+
+static void
+usage (FILE *f)
+{
+	fprintf (f,
+		 "Usage: %s [options] [input.ihx]\n"
+		 "  -m, --map FILE        linker map file, to look up run symbols\n"
+		 "  -r, --run SYM|ADDR    run address, symbol or &hex/0xhex, may be repeated,\n"
+		 "                        the first one found wins\n"
+		 "  -n, --name NAME       name on disc and tape (default: input base name)\n"
+		 "  -b, --bin FILE        write raw binary\n"
+		 "  -a, --amsdos FILE     write binary with AMSDOS header\n"
+		 "  -d, --dsk FILE        write or update DATA format disc image\n"
+		 "  -f, --file SPEC       put a file on the disc image instead of input.ihx,\n"
+		 "                        may be repeated; SPEC is path[:name=NAME.EXT]\n"
+		 "                        [:load=ADDR][:exec=ADDR][:raw]\n"
+		 "  -c, --cdt FILE        write tape image\n"
+		 "  -B, --baud N          tape speed (default 2000)\n"
+		 "  -t, --turbo-loader FILE\n"
+		 "                        put this cdtc_turbo_loader .ihx (with its .map) on\n"
+		 "                        tape, then the program at turbo speed\n"
+		 "  -T, --turbo-baud N    turbo speed (default 4000)\n"
+		 "  -s, --sna FILE        write snapshot, from the one given with --boot-sna\n"
+		 "  -S, --boot-sna FILE   snapshot saved by cap32 once booted\n"
+		 "  -h, --help\n",
+		 progname);
+}
+
+int
+main (int argc, char **argv)
+{
+	static struct image img, loader;
+	static const struct option options[] = {
+		{"map", required_argument, NULL, 'm'},
+		{"run", required_argument, NULL, 'r'},
+		{"name", required_argument, NULL, 'n'},
+		{"bin", required_argument, NULL, 'b'},
+		{"amsdos", required_argument, NULL, 'a'},
+		{"dsk", required_argument, NULL, 'd'},
+		{"file", required_argument, NULL, 'f'},
+		{"cdt", required_argument, NULL, 'c'},
+		{"baud", required_argument, NULL, 'B'},
+		{"turbo-loader", required_argument, NULL, 't'},
+		{"turbo-baud", required_argument, NULL, 'T'},
+		{"sna", required_argument, NULL, 's'},
+		{"boot-sna", required_argument, NULL, 'S'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0}
+	};
+	const char *mapname = NULL, *name = NULL, *bin = NULL, *amsdos = NULL;
+	const char *dsk = NULL, *cdt = NULL, *input = NULL, *turbo_loader = NULL;
+	const char *sna = NULL, *boot_sna = NULL;
+	char **run = calloc (argc, sizeof (char *));
+	char **specs = calloc (argc, sizeof (char *));
+	struct disc_file *files = calloc (argc + 1, sizeof (struct disc_file));
+	int nrun = 0, nspecs = 0, opt, i;
+	unsigned int baud = 2000, turbo_baud = 4000;
+	uint8_t disc_name[11], header[AMSDOS_HEADER_SIZE];
+
+	if (run == NULL || specs == NULL || files == NULL)
+		die ("out of memory");
+
+	while ((opt = getopt_long (argc, argv, "m:r:n:b:a:d:f:c:B:t:T:s:S:h", options, NULL)) != -1)
+	{
+		switch (opt)
+		{
+		case 'm': mapname = optarg; break;
+		case 'r': run[nrun++] = optarg; break;
+		case 'n': name = optarg; break;
+		case 'b': bin = optarg; break;
+		case 'a': amsdos = optarg; break;
+		case 'd': dsk = optarg; break;
+		case 'f': specs[nspecs++] = optarg; break;
+		case 'c': cdt = optarg; break;
+		case 'B':
+			baud = atoi (optarg);
+			if (baud < 300 || baud > 4000)
+				die ("baud rate out of range: %s", optarg);
+			break;
+		case 't': turbo_loader = optarg; break;
+		case 'T':
+			turbo_baud = atoi (optarg);
+			if (turbo_baud < 1000 || turbo_baud > 6000)
+				die ("turbo baud rate out of range: %s", optarg);
+			break;
+		case 's': sna = optarg; break;
+		case 'S': boot_sna = optarg; break;
+		case 'h': usage (stdout); return 0;
+		default: usage (stderr); return 1;
+		}
+	}
+	if (optind == argc - 1)
+		input = argv[optind];
+	else if (optind != argc || (bin || amsdos || cdt || sna || (dsk && nspecs == 0)))
+	{
+		usage (stderr);
+		return 1;
+	}
+	if (sna != NULL && boot_sna == NULL)
+		die ("--sna needs --boot-sna");
+
+	if (input != NULL)
+	{
+		if (name == NULL)
+			name = input;
+		load_ihx (&img, input);
+		find_run_address (&img, mapname, run, nrun);
+		make_disc_name (disc_name, name, "BIN");
+		make_amsdos_header (header, disc_name, img.load, img.length, img.run);
+
+		printf ("%s: %s: load &%04X, length &%04X (%u bytes), run &%04X\n",
+			progname, input, img.load, img.length, img.length, img.run);
+
+		if (bin != NULL)
+			write_bin (&img, bin, NULL);
+		if (amsdos != NULL)
+			write_bin (&img, amsdos, header);
+		if (cdt != NULL && turbo_loader != NULL)
+		{
+			setup_turbo_loader (&loader, turbo_loader, &img);
+			write_cdt (&img, cdt, name, baud, &loader, turbo_baud);
+		}
+		else if (cdt != NULL)
+			write_cdt (&img, cdt, name, baud, NULL, 0);
+		if (sna != NULL)
+			write_sna (&img, sna, boot_sna);
+	}
+
+	if (dsk != NULL)
+	{
+		int nfiles = 0;
+
+		if (nspecs == 0)
+		{
+			files[0].path = input;
+			memcpy (files[0].name, disc_name, 11);
+			files[0].length = AMSDOS_HEADER_SIZE + img.length;
+			files[0].content = malloc (files[0].length);
+			if (files[0].content == NULL)
+				die ("out of memory");
+			memcpy (files[0].content, header, AMSDOS_HEADER_SIZE);
+			memcpy (files[0].content + AMSDOS_HEADER_SIZE, img.memory + img.load, img.length);
+			nfiles = 1;
+		}
+		for (i = 0; i < nspecs; i++)
+			load_disc_file (&files[nfiles++], specs[i], run, nrun);
+		write_dsk (dsk, files, nfiles);
+	}
+
+	free (run);
+	free (specs);
+	return 0;
+}
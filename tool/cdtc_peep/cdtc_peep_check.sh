@@ -0,0 +1,231 @@
+#!/bin/bash
+
+# Check that the rules of an SDCC peephole file preserve semantics, and
+# tell what each one saves.
+#
+# Usage:
+#   cdtc_peep_check.sh RULES.peep WORKDIR
+#
+# Each rule must follow a "// cdtc: NAME [%N=VALUE]..." line, see
+# cdtc_z80.peep.  Both sides of each rule, with its %N replaced, are
+# assembled into one program in WORKDIR.  Each side is then run in
+# cdtc_sim CDTC_PEEP_TRIALS times (default 20), each time with random
+# registers, flags, stack pointer and memory, the same for both sides.  The registers
+# and the whole memory must match after both, except the registers
+# that the notUsed() conditions of the rule declare dead.  Other
+# conditions are not checked: they only restrict where the rule
+# applies.
+#
+# Prints one line per rule: its name, bytes and NOPs before and after,
+# and "ok" or what differs.  NOPs are those of the first trial.  The
+# last line tells how many rules were checked and how many failed.
+# Exits 1 if any rule fails.  sdasz80, sdcc and cdtc_sim must be in the
+# PATH.
+
+set -eu -o pipefail
+
+if [[ $# -ne 2 ]]
+then
+    echo >&2 "Usage: $0 RULES.peep WORKDIR"
+    exit 2
+fi
+
+RULES="$1"
+WORKDIR="$2"
+TRIALS="${CDTC_PEEP_TRIALS:-20}"
+
+mkdir -p "$WORKDIR"
+rm -f "$WORKDIR"/peep_check.* "$WORKDIR"/trial.* "$WORKDIR"/rules.txt
+
+########################################################################
+# Write both sides of each rule as routines
+########################################################################
+
+# peep_N_before and peep_N_after first load AF from IY, so that flags
+# are random too, then run the code of the rule and return.
+# peep_empty only does the loading, to subtract its cost.  rules.txt
+# has "N NAME DEAD-REGISTERS" lines, "-" if none is dead.
+awk -v out="$WORKDIR/peep_check.s" -v list="$WORKDIR/rules.txt" '
+function fail(msg)
+{
+    printf "%s:%d: %s\n", FILENAME, FNR, msg >"/dev/stderr"
+    bad = 1
+    exit 1
+}
+function emit(side,   i, line, v)
+{
+    printf "peep_%d_%s::\n\tpush\tiy\n\tpop\taf\n", n, side >out
+    for (i = 0; i < nbody[side]; i++)
+    {
+        line = body[side, i]
+        for (v in value)
+            gsub(v, value[v], line)
+        if (line ~ /%[0-9]/)
+            fail("rule " name ": no value for " line)
+        print line >out
+    }
+    printf "peep_%d_%s_end::\n\tret\n", n, side >out
+}
+BEGIN {
+    print "\t.module peep_check\n\t.area _CODE\npeep_empty::\n\tpush\tiy\n\tpop\taf\n\tret" >out
+}
+/^\/\/ cdtc:/ {
+    name = $3
+    split("", value)
+    for (i = 4; i <= NF; i++)
+    {
+        eq = index($i, "=")
+        value[substr($i, 1, eq - 1)] = substr($i, eq + 1)
+    }
+    next
+}
+/^\/\// || /^[ \t]*$/ { next }
+state == "" && /^replace/ {
+    if (name == "")
+        fail("rule without a // cdtc: line before it")
+    state = "before"
+    nbody["before"] = nbody["after"] = 0
+    next
+}
+state == "before" && /^}[ \t]*by[ \t]*{/ { state = "after" ; next }
+state == "after" && /^}/ {
+    dead = ""
+    rest = $0
+    while (match(rest, /notUsed\(\047[a-z]+\047\)/))
+    {
+        regs = substr(rest, RSTART + 9, RLENGTH - 11)
+        for (i = 1; i <= length(regs); i++)
+            dead = dead substr(regs, i, 1)
+        rest = substr(rest, RSTART + RLENGTH)
+    }
+    n++
+    emit("before")
+    emit("after")
+    print n, name, (dead == "" ? "-" : dead) >list
+    name = ""
+    state = ""
+    next
+}
+state != "" { body[state, nbody[state]++] = $0 ; next }
+{ fail("unexpected line outside a rule: " $0) }
+END {
+    if (!bad && state != "")
+        fail("unterminated rule " name)
+}
+' "$RULES"
+
+########################################################################
+# Build
+########################################################################
+
+( cd "$WORKDIR" ;
+  sdasz80 -o peep_check.rel peep_check.s ;
+  sdcc -mz80 --no-std-crt0 --code-loc 0x0100 --data-loc 0 peep_check.rel -o peep_check.ihx ; )
+
+function symbol()
+{
+    awk -v name="$1" '$2 == name { print substr($1, 5) ; exit }' "$WORKDIR/peep_check.map"
+}
+
+function size()
+{
+    echo $(( 16#$( symbol "${1}_end" ) - 16#$( symbol "$1" ) - 3 ))
+}
+
+########################################################################
+# Run
+########################################################################
+
+function random16()
+{
+    printf 0x%04X $(( (RANDOM << 1 ^ RANDOM) & 0xFFFF ))
+}
+
+# Prints the NOPs, or "-" if the routine did not return, and the
+# registers after calling $1 with random state $2 (the arguments for
+# cdtc_sim) and writes memory to $3.0 and $3.8.
+function run()
+{
+    local OUTPUT NOPS
+    OUTPUT=$( cdtc_sim -l "$WORKDIR/trial.mem@0" -l "$WORKDIR/peep_check.ihx" -m "$WORKDIR/peep_check.map" -t 1000000 $2 -c "$1" -d "0:0x8000:$3.0" -d "0x8000:0x8000:$3.8" || true )
+    NOPS=$( sed -n 's/^cdtc_sim: returned .* \([0-9]*\) NOPs$/\1/p' <<<"$OUTPUT" )
+    echo "${NOPS:--}"
+    sed -n 's/^cdtc_sim: \(A=.*\)$/\1/p' <<<"$OUTPUT"
+}
+
+# Registers as "NAME=VALUE" lines, one per 8-bit register, less the
+# dead ones (letters in $1).  IX, IY and SP are always compared.
+function registers()
+{
+    local DEAD="$1" WORD NAME VALUE I
+    for WORD in $2
+    do
+        NAME="${WORD%%=*}"
+        VALUE="${WORD#*=}"
+        case "$NAME" in
+            A|F) [[ "$DEAD" == *"$NAME"* ]] || echo "$WORD" ;;
+            BC|DE|HL)
+                for I in 0 1
+                do
+                    [[ "$DEAD" == *"${NAME:I:1}"* ]] || echo "${NAME:I:1}=${VALUE:I*2:2}"
+                done ;;
+            *) echo "$WORD" ;;
+        esac
+    done
+}
+
+head -c 65536 /dev/urandom >"$WORKDIR/trial.mem"
+EMPTY=$( run peep_empty "" "$WORKDIR/trial.empty" )
+EMPTY=$( head -1 <<<"$EMPTY" )
+COUNT=0
+FAILED=0
+printf "%-20s %17s %17s  %s\n" "" bytes NOPs ""
+printf "%-20s %8s %8s %8s %8s  %s\n" rule before after before after check
+while read -r N NAME DEAD
+do
+    DEAD="${DEAD^^}"
+    VERDICT=ok
+    NOPS_BEFORE=-
+    NOPS_AFTER=-
+    for (( TRIAL = 0 ; TRIAL < TRIALS ; TRIAL++ ))
+    do
+        head -c 65536 /dev/urandom >"$WORKDIR/trial.mem"
+        # Every other trial, SP is just below a 4K boundary, where
+        # adding a small offset to it changes the half carry or carry.
+        if (( TRIAL & 1 ))
+        then SP=$(( 0x8FF8 | (RANDOM & 0x7007) ))
+        else SP=$(( 0x8000 | (RANDOM & 0x7FFF) ))
+        fi
+        STATE="-s $( printf 0x%04X $SP ) -r iy=$( random16 ) -r bc=$( random16 ) -r de=$( random16 ) -r hl=$( random16 ) -r ix=$( random16 )"
+        BEFORE=$( run "peep_${N}_before" "$STATE" "$WORKDIR/trial.before" )
+        AFTER=$( run "peep_${N}_after" "$STATE" "$WORKDIR/trial.after" )
+        if [[ "$( head -1 <<<"$BEFORE" )" == - || "$( head -1 <<<"$AFTER" )" == - ]]
+        then
+            VERDICT="FAIL did not return with $STATE"
+            break
+        fi
+        if [[ $TRIAL -eq 0 ]]
+        then
+            NOPS_BEFORE=$(( $( head -1 <<<"$BEFORE" ) - EMPTY ))
+            NOPS_AFTER=$(( $( head -1 <<<"$AFTER" ) - EMPTY ))
+        fi
+        REGS_BEFORE=$( registers "$DEAD" "$( tail -1 <<<"$BEFORE" )" )
+        REGS_AFTER=$( registers "$DEAD" "$( tail -1 <<<"$AFTER" )" )
+        if [[ "$REGS_BEFORE" != "$REGS_AFTER" ]]
+        then
+            VERDICT="FAIL registers differ with $STATE: $( tail -1 <<<"$BEFORE" ) / $( tail -1 <<<"$AFTER" )"
+            break
+        fi
+        if ! cmp -s "$WORKDIR/trial.before.0" "$WORKDIR/trial.after.0" || ! cmp -s "$WORKDIR/trial.before.8" "$WORKDIR/trial.after.8"
+        then
+            VERDICT="FAIL memory differs with $STATE"
+            break
+        fi
+    done
+    printf "%-20s %8s %8s %8s %8s  %s\n" "$NAME" "$( size "peep_${N}_before" )" "$( size "peep_${N}_after" )" "$NOPS_BEFORE" "$NOPS_AFTER" "$VERDICT"
+    COUNT=$(( COUNT + 1 ))
+    [[ "$VERDICT" == ok ]] || FAILED=$(( FAILED + 1 ))
+done <"$WORKDIR/rules.txt"
+
+echo "$COUNT rules checked, $FAILED failed"
+[[ $FAILED -eq 0 ]]
@@ -0,0 +1,189 @@
+/*
+ * cdtc_probe: decode what a program wrote to the probe port.
+ *
+ * cdtc_sim --probe FILE records each OUT to a port &FFxx as 6 bytes:
+ * the NOPs since the start (32 bits, least significant byte first), the
+ * low byte of the port and the value.  The program writes, see
+ * cpclib/cdtc_probe:
+ *
+ *   &FF00  the id of an event
+ *   &FF01  the id of a counter, then
+ *   &FF02  each byte of its value, least significant first
+ *
+ *   cdtc_probe [--csv] FILE
+ *
+ * prints one line per event or counter, at the NOPs when its id was
+ * written.  As text: the NOPs, the NOPs since the previous record, and
+ * the record.  As CSV: "nops,record,id,value", value empty for events.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RECORD_SIZE 6
+#define PORT_EVENT 0x00
+#define PORT_COUNTER 0x01
+#define PORT_DATA 0x02
+#define MAX_COUNTER_BYTES 8
+
+static const char *progname = "cdtc_probe";
+
+static void
+die (const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start (ap, fmt);
+	fprintf (stderr, "%s: ", progname);
+	vfprintf (stderr, fmt, ap);
+	fputc ('\n', stderr);
+	va_end (ap);
+	exit (1);
+}
+
+/* An event or counter, printed once complete: a counter is, when the
+   next record starts or at the end. */
+struct record
+{
+	int pending;
+	int is_counter;
+	uint8_t id;
+	unsigned int bytes;
+	uint64_t value;
+	uint64_t nops;
+};
+
+static int csv;
+static uint64_t previous_nops;
+
+static void
+print_record (struct record *r)
+{
+	if (!r->pending)
+		return;
+	r->pending = 0;
+	if (csv)
+	{
+		printf ("%llu,%s,%u,", (unsigned long long) r->nops,
+			r->is_counter ? "counter" : "event", r->id);
+		if (r->is_counter)
+			printf ("%llu", (unsigned long long) r->value);
+		putchar ('\n');
+	}
+	else
+	{
+		printf ("%10llu %10llu  ", (unsigned long long) r->nops,
+			(unsigned long long) (r->nops - previous_nops));
+		if (r->is_counter)
+			printf ("counter %u = %llu\n", r->id, (unsigned long long) r->value);
+		else
+			printf ("event %u\n", r->id);
+	}
+	previous_nops = r->nops;
+}
+
+static void
+decode (const char *filename)
+{
+	FILE *f = fopen (filename, "rb");
+	uint8_t raw[RECORD_SIZE];
+	struct record r;
+	unsigned long index = 0;
+	uint32_t last = 0;
+	uint64_t nops = 0;
+	size_t got;
+
+	if (f == NULL)
+		die ("%s: %s", filename, strerror (errno));
+	memset (&r, 0, sizeof (r));
+	if (csv)
+		printf ("nops,record,id,value\n");
+	else
+		printf ("%10s %10s  %s\n", "NOPs", "delta", "record");
+
+	while ((got = fread (raw, 1, RECORD_SIZE, f)) == RECORD_SIZE)
+	{
+		uint32_t stamp = raw[0] | raw[1] << 8 | raw[2] << 16 | (uint32_t) raw[3] << 24;
+
+		/* The 32-bit stamps wrap after 71 minutes of CPC time. */
+		nops += (uint32_t) (stamp - last);
+		last = stamp;
+		switch (raw[4])
+		{
+		case PORT_EVENT:
+		case PORT_COUNTER:
+			print_record (&r);
+			r.pending = 1;
+			r.is_counter = raw[4] == PORT_COUNTER;
+			r.id = raw[5];
+			r.bytes = 0;
+			r.value = 0;
+			r.nops = nops;
+			break;
+		case PORT_DATA:
+			if (!r.pending || !r.is_counter)
+				die ("%s: record %lu: value byte without a counter", filename, index);
+			if (r.bytes == MAX_COUNTER_BYTES)
+				die ("%s: record %lu: counter %u has more than %d bytes",
+				     filename, index, r.id, MAX_COUNTER_BYTES);
+			r.value |= (uint64_t) raw[5] << (8 * r.bytes++);
+			break;
+		default:
+			die ("%s: record %lu: unknown port &FF%02X", filename, index, raw[4]);
+		}
+		index++;
+	}
+	if (ferror (f))
+		die ("%s: %s", filename, strerror (errno));
+	if (got != 0)
+		die ("%s: truncated record %lu", filename, index);
+	fclose (f);
+	print_record (&r);
+}
+
+static void
+usage (FILE *f)
+{
+	fprintf (f,
+		 "Usage: %s [options] FILE\n"
+		 "  -c, --csv   print CSV instead of text\n"
+		 "  -h, --help\n"
+		 "FILE is written by cdtc_sim --probe.\n",
+		 progname);
+}
+
+int
+main (int argc, char **argv)
+{
+	static const struct option options[] = {
+		{"csv", no_argument, NULL, 'c'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0}
+	};
+	int opt;
+
+	while ((opt = getopt_long (argc, argv, "ch", options, NULL)) != -1)
+	{
+		switch (opt)
+		{
+		case 'c': csv = 1; break;
+		case 'h': usage (stdout); return 0;
+		default: usage (stderr); return 1;
+		}
+	}
+	if (optind != argc - 1)
+	{
+		usage (stderr);
+		return 1;
+	}
+
+	decode (argv[optind]);
+	if (fflush (stdout) != 0 || ferror (stdout))
+		die ("standard output: %s", strerror (errno));
+	return 0;
+}
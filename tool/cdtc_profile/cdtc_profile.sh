@@ -0,0 +1,126 @@
+#!/bin/bash
+
+# Turn the PC samples of cdtc_sim --profile into a list of the hottest
+# functions and a folded-stack file.
+#
+# Usage:
+#   cdtc_profile.sh SAMPLES FOLDED SYMBOLS...
+#
+# SAMPLES has one line per sample, as written by cdtc_sim --profile:
+# the PC in hex, with --stacks after the entry of each frame, outermost
+# first.  SYMBOLS are the linker .map and .noi files of the program:
+# each address goes to the symbol at or below it.  Only global symbols
+# are there, so static functions count in the global function before
+# them.  The PC is shown as a frame of its own only when it is not in
+# the function entered last.  Module .sym files are not used, their
+# values are relative to their areas.
+#
+# Prints for each function the samples taken in it (self) and those
+# taken while it was on the stack (total), hottest first.  FOLDED gets
+# one line per distinct stack, "outer;inner;leaf COUNT", as read by
+# flamegraph.pl and other flame graph tools.  Without --stacks in the
+# samples, self and total are the same and FOLDED has only leaves.
+
+set -eu -o pipefail
+
+if [[ $# -lt 3 ]]
+then
+    echo >&2 "Usage: $0 SAMPLES FOLDED SYMBOLS..."
+    exit 2
+fi
+
+SAMPLES="$1"
+FOLDED="$2"
+shift 2
+
+# "ADDRESS NAME" lines, in decimal and address order, one symbol per
+# address: C names (leading "_") win over others at the same address.
+# Area bounds (s__CODE, l__DATA...) and local labels are left out.
+SYMBOLS=$( awk '
+function hex(s,   i, n)
+{
+    n = 0
+    s = toupper(s)
+    sub(/^0X/, "", s)
+    for (i = 1; i <= length(s); i++)
+        n = n * 16 + index("0123456789ABCDEF", substr(s, i, 1)) - 1
+    return n
+}
+function add(address, name)
+{
+    if (name ~ /^[sl]__/ || name ~ /^\./ || name ~ /\$/)
+        return
+    print address, (substr(name, 1, 1) == "_" ? 0 : 1), name
+}
+$1 ~ /^0000[0-9A-Fa-f][0-9A-Fa-f][0-9A-Fa-f][0-9A-Fa-f]$/ && NF >= 2 { add(hex(substr($1, 5)), $2) }
+$1 == "DEF" && NF >= 3 { add(hex($3), $2) }
+' "$@" | sort -n -k1,1 -k2,2 | awk '$1 != last { print $1, $3 ; last = $1 }' )
+
+if [[ -z "$SYMBOLS" ]]
+then
+    echo >&2 "$0: no symbols in $*"
+    exit 1
+fi
+
+awk -v folded="$FOLDED.tmp" '
+function hex(s,   i, n)
+{
+    n = 0
+    for (i = 1; i <= length(s); i++)
+        n = n * 16 + index("0123456789ABCDEF", substr(s, i, 1)) - 1
+    return n
+}
+# Symbol at or below address a, or the address itself if none.
+function resolve(s,   a, lo, hi, mid)
+{
+    if (s in cache)
+        return cache[s]
+    a = hex(s)
+    lo = 0
+    hi = nsym - 1
+    if (nsym == 0 || a < address[0])
+        return cache[s] = "&" s
+    while (lo < hi)
+    {
+        mid = int((lo + hi + 1) / 2)
+        if (address[mid] <= a)
+            lo = mid
+        else
+            hi = mid - 1
+    }
+    return cache[s] = name[lo]
+}
+FILENAME == "-" { address[nsym] = $1 ; name[nsym++] = $2 ; next }
+NF > 0 {
+    samples++
+    stack = ""
+    split("", seen)
+    for (i = 1; i <= NF; i++)
+    {
+        f = resolve($i)
+        # The PC is most often in the function of the innermost frame.
+        if (i == NF && i > 1 && f == resolve($(i - 1)))
+            break
+        stack = stack (i > 1 ? ";" : "") f
+        if (!(f in seen))
+        {
+            seen[f] = 1
+            total[f]++
+        }
+    }
+    self[f]++
+    count[stack]++
+}
+END {
+    for (s in count)
+        print s, count[s] >folded
+    printf "%d samples\n", samples
+    printf "%-32s %8s %7s %8s %7s\n", "function", "self", "self %", "total", "total %"
+    for (f in total)
+        printf "%-32s %8d %7.1f %8d %7.1f\n", f, self[f], 100 * self[f] / samples, total[f], 100 * total[f] / samples | "sort -k2,2nr -k4,4nr -k1,1"
+}
+' - "$SAMPLES" <<<"$SYMBOLS"
+
+sort "$FOLDED.tmp" >"$FOLDED.sorted.tmp"
+rm -f "$FOLDED.tmp"
+mv -f "$FOLDED.sorted.tmp" "$FOLDED"
@@ -0,0 +1,448 @@
+/*
+ * cdtc_relgc: drop the modules of a program that nothing uses.
+ *
+ * Reads the symbol tables of the relocatable files (.rel) of a program,
+ * follows references from the root symbols (the run address, main)
+ * through the modules that define them, and prints the files of the
+ * modules reached, in the order given, for the linker.  Modules nothing
+ * reaches are left out: their code and data do not end up in the binary.
+ *
+ *   cdtc_relgc [--root SYM]... [--lib FILE]... [--report FILE] file.rel...
+ *
+ * SDCC gives each C or assembler source one module, and its linker has
+ * no per-function sections, so a module is kept or dropped as a whole.
+ * cdtc_split_asm.sh makes one module per function of a C file first,
+ * so that unused functions go too.
+ *
+ * Symbols that library modules (--lib, .rel or .lib files) refer to are
+ * roots too, since a library may call back into the program (putchar).
+ * Modules with code or data at absolute addresses are always kept.  If
+ * no root is defined by any module, every module is kept.
+ *
+ * The report lists each module kept or removed, with the bytes removed
+ * per area.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LINE 4096
+#define MAX_AREAS 64
+
+/* Area flag of asxxxx relocatable files: absolute area. */
+#define AREA_ABS 0x08
+
+static const char *progname = "cdtc_relgc";
+
+static void
+die (const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start (ap, fmt);
+	fprintf (stderr, "%s: ", progname);
+	vfprintf (stderr, fmt, ap);
+	fputc ('\n', stderr);
+	va_end (ap);
+	exit (1);
+}
+
+static void *
+xmalloc (size_t size)
+{
+	void *p = malloc (size);
+
+	if (p == NULL)
+		die ("out of memory");
+	return p;
+}
+
+static void *
+xrealloc (void *p, size_t size)
+{
+	p = realloc (p, size);
+	if (p == NULL)
+		die ("out of memory");
+	return p;
+}
+
+static char *
+xstrdup (const char *s)
+{
+	char *p = xmalloc (strlen (s) + 1);
+
+	strcpy (p, s);
+	return p;
+}
+
+/************************************************************************
+ * Symbol name to defining module, in a hash table
+ ************************************************************************/
+
+struct definition
+{
+	char *name;
+	int module;
+};
+
+struct symbol_table
+{
+	struct definition *slots;
+	unsigned int size;	/* power of two */
+	unsigned int count;
+};
+
+static unsigned int
+hash_name (const char *s)
+{
+	unsigned int h = 2166136261u;
+
+	while (*s != '\0')
+		h = (h ^ (unsigned char) *s++) * 16777619u;
+	return h;
+}
+
+static struct definition *
+symbol_slot (const struct symbol_table *table, const char *name)
+{
+	unsigned int i = hash_name (name) & (table->size - 1);
+
+	while (table->slots[i].name != NULL
+	       && strcmp (table->slots[i].name, name) != 0)
+		i = (i + 1) & (table->size - 1);
+	return &table->slots[i];
+}
+
+static void symbol_define (struct symbol_table *table, const char *name,
+			   int module);
+
+static void
+symbol_table_grow (struct symbol_table *table)
+{
+	struct symbol_table bigger;
+	unsigned int i;
+
+	bigger.size = table->size ? table->size * 2 : 1024;
+	bigger.count = 0;
+	bigger.slots = xmalloc (bigger.size * sizeof *bigger.slots);
+	memset (bigger.slots, 0, bigger.size * sizeof *bigger.slots);
+	for (i = 0; i < table->size; i++)
+		if (table->slots[i].name != NULL)
+			symbol_define (&bigger, table->slots[i].name,
+				       table->slots[i].module);
+	free (table->slots);
+	*table = bigger;
+}
+
+/* The first definition wins, the linker reports duplicates. */
+static void
+symbol_define (struct symbol_table *table, const char *name, int module)
+{
+	struct definition *slot;
+
+	if (table->count * 2 >= table->size)
+		symbol_table_grow (table);
+	slot = symbol_slot (table, name);
+	if (slot->name == NULL)
+	{
+		slot->name = (char *) name;
+		slot->module = module;
+		table->count++;
+	}
+}
+
+static int
+symbol_module (const struct symbol_table *table, const char *name)
+{
+	const struct definition *slot;
+
+	if (table->size == 0)
+		return -1;
+	slot = symbol_slot (table, name);
+	return slot->name != NULL ? slot->module : -1;
+}
+
+/************************************************************************
+ * Relocatable files
+ ************************************************************************/
+
+struct area
+{
+	char *name;
+	unsigned long size;
+	unsigned int flags;
+};
+
+struct module
+{
+	const char *filename;
+	char **refs;
+	unsigned int ref_count;
+	struct area areas[MAX_AREAS];
+	unsigned int area_count;
+	int absolute;		/* has code or data at a fixed address */
+	int kept;
+};
+
+static void
+add_ref (struct module *m, const char *name)
+{
+	if ((m->ref_count & (m->ref_count - 1)) == 0)
+		m->refs = xrealloc (m->refs, (m->ref_count ? m->ref_count * 2 : 1)
+				    * sizeof *m->refs);
+	m->refs[m->ref_count++] = xstrdup (name);
+}
+
+/* The first letter of the first line (X, D or Q) gives the radix of
+ * numbers in the file. */
+static int
+radix_of (const char *line)
+{
+	switch (line[0])
+	{
+	case 'D': return 10;
+	case 'Q': return 8;
+	default: return 16;
+	}
+}
+
+/* "A name size 1A flags 0 ..." lines declare areas, "S name Def0012"
+ * and "S name Ref0000" lines define and refer to global symbols. */
+static void
+read_rel (const char *filename, struct module *m, int index,
+	  struct symbol_table *defs)
+{
+	FILE *f = fopen (filename, "r");
+	char line[MAX_LINE];
+	int radix = 16, first = 1;
+
+	if (f == NULL)
+		die ("%s: %s", filename, strerror (errno));
+	m->filename = filename;
+	while (fgets (line, sizeof line, f) != NULL)
+	{
+		char name[MAX_LINE], size[MAX_LINE], flags[MAX_LINE], kind[4];
+
+		if (first)
+		{
+			radix = radix_of (line);
+			first = 0;
+		}
+		if (sscanf (line, "A %s size %s flags %s", name, size, flags) == 3)
+		{
+			struct area *a;
+
+			if (m->area_count == MAX_AREAS)
+				die ("%s: more than %d areas", filename, MAX_AREAS);
+			a = &m->areas[m->area_count++];
+			a->name = xstrdup (name);
+			a->size = strtoul (size, NULL, radix);
+			a->flags = strtoul (flags, NULL, radix);
+			if ((a->flags & AREA_ABS) && a->size != 0)
+				m->absolute = 1;
+		}
+		else if (sscanf (line, "S %s %3s", name, kind) == 2)
+		{
+			if (strcmp (kind, "Def") == 0 && name[0] != '.')
+				symbol_define (defs, xstrdup (name), index);
+			else if (strcmp (kind, "Ref") == 0)
+				add_ref (m, name);
+		}
+	}
+	if (ferror (f))
+		die ("%s: %s", filename, strerror (errno));
+	fclose (f);
+}
+
+/* Symbols that library files refer to.  An .lib is an archive of .rel
+ * files, which are text, so its lines can be read the same way. */
+static void
+read_lib_refs (const char *filename, struct module *lib)
+{
+	FILE *f = fopen (filename, "r");
+	char line[MAX_LINE];
+
+	if (f == NULL)
+		die ("%s: %s", filename, strerror (errno));
+	while (fgets (line, sizeof line, f) != NULL)
+	{
+		char name[MAX_LINE], kind[4];
+
+		if (line[0] == 'S'
+		    && sscanf (line, "S %s %3s", name, kind) == 2
+		    && strcmp (kind, "Ref") == 0)
+			add_ref (lib, name);
+	}
+	fclose (f);
+}
+
+/************************************************************************
+ * Reachability
+ ************************************************************************/
+
+static void
+keep (struct module *modules, int index, int *stack, int *depth)
+{
+	if (index < 0 || modules[index].kept)
+		return;
+	modules[index].kept = 1;
+	stack[(*depth)++] = index;
+}
+
+static void
+mark (struct module *modules, int count, const struct symbol_table *defs,
+      char **roots, int root_count, const struct module *lib)
+{
+	int *stack = xmalloc (count * sizeof *stack);
+	int depth = 0, i;
+	unsigned int r;
+
+	for (i = 0; i < root_count; i++)
+		keep (modules, symbol_module (defs, roots[i]), stack, &depth);
+	if (depth == 0)
+	{
+		fprintf (stderr, "%s: no root symbol defined, keeping every module\n",
+			 progname);
+		for (i = 0; i < count; i++)
+			modules[i].kept = 1;
+		free (stack);
+		return;
+	}
+	for (r = 0; r < lib->ref_count; r++)
+		keep (modules, symbol_module (defs, lib->refs[r]), stack, &depth);
+	for (i = 0; i < count; i++)
+		if (modules[i].absolute)
+			keep (modules, i, stack, &depth);
+
+	while (depth > 0)
+	{
+		const struct module *m = &modules[stack[--depth]];
+
+		for (r = 0; r < m->ref_count; r++)
+			keep (modules, symbol_module (defs, m->refs[r]), stack, &depth);
+	}
+	free (stack);
+}
+
+static unsigned long
+report_module (FILE *f, const struct module *m)
+{
+	unsigned long total = 0;
+	unsigned int i;
+
+	if (m->kept)
+	{
+		fprintf (f, "kept     %s\n", m->filename);
+		return 0;
+	}
+	fprintf (f, "removed  %s ", m->filename);
+	for (i = 0; i < m->area_count; i++)
+	{
+		if ((m->areas[i].flags & AREA_ABS) || m->areas[i].size == 0)
+			continue;
+		fprintf (f, " %s %lu", m->areas[i].name, m->areas[i].size);
+		total += m->areas[i].size;
+	}
+	fprintf (f, "  (%lu bytes)\n", total);
+	return total;
+}
+
+/************************************************************************
+ * Main
+ ************************************************************************/
+
+static void
+usage (FILE *f)
+{
+	fprintf (f,
+		 "Usage: %s [options] file.rel...\n"
+		 "  -r, --root SYM     keep what SYM needs, may be repeated\n"
+		 "  -l, --lib FILE     library (.rel or .lib) linked too, symbols it refers to are roots\n"
+		 "  -o, --report FILE  write modules kept and bytes removed to FILE\n"
+		 "  -h, --help\n"
+		 "Prints the files of the modules to link.\n",
+		 progname);
+}
+
+int
+main (int argc, char **argv)
+{
+	static const struct option options[] = {
+		{"root", required_argument, NULL, 'r'},
+		{"lib", required_argument, NULL, 'l'},
+		{"report", required_argument, NULL, 'o'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0}
+	};
+	char **roots = calloc (argc, sizeof (char *));
+	char **libs = calloc (argc, sizeof (char *));
+	int root_count = 0, lib_count = 0, count, opt, i;
+	const char *report = NULL;
+	struct symbol_table defs = { NULL, 0, 0 };
+	struct module lib, *modules;
+	unsigned long removed = 0;
+	int removed_count = 0;
+	FILE *f;
+
+	if (roots == NULL || libs == NULL)
+		die ("out of memory");
+
+	while ((opt = getopt_long (argc, argv, "r:l:o:h", options, NULL)) != -1)
+	{
+		switch (opt)
+		{
+		case 'r': roots[root_count++] = optarg; break;
+		case 'l': libs[lib_count++] = optarg; break;
+		case 'o': report = optarg; break;
+		case 'h': usage (stdout); return 0;
+		default: usage (stderr); return 1;
+		}
+	}
+	count = argc - optind;
+	if (count == 0)
+	{
+		usage (stderr);
+		return 1;
+	}
+
+	modules = xmalloc (count * sizeof *modules);
+	memset (modules, 0, count * sizeof *modules);
+	for (i = 0; i < count; i++)
+		read_rel (argv[optind + i], &modules[i], i, &defs);
+	memset (&lib, 0, sizeof lib);
+	for (i = 0; i < lib_count; i++)
+		read_lib_refs (libs[i], &lib);
+
+	mark (modules, count, &defs, roots, root_count, &lib);
+
+	for (i = 0; i < count; i++)
+		if (modules[i].kept)
+			printf ("%s\n", modules[i].filename);
+
+	f = report ? fopen (report, "w") : NULL;
+	if (report != NULL && f == NULL)
+		die ("%s: %s", report, strerror (errno));
+	for (i = 0; i < count; i++)
+	{
+		if (!modules[i].kept)
+			removed_count++;
+		if (f != NULL)
+			removed += report_module (f, &modules[i]);
+		else if (!modules[i].kept)
+			removed += report_module (stderr, &modules[i]);
+	}
+	if (f != NULL)
+	{
+		fprintf (f, "removed %d of %d modules, %lu bytes\n",
+			 removed_count, count, removed);
+		if (fclose (f) != 0)
+			die ("%s: %s", report, strerror (errno));
+	}
+	fprintf (stderr, "%s: removed %d of %d modules, %lu bytes\n",
+		 progname, removed_count, count, removed);
+	return 0;
+}
@@ -0,0 +1,187 @@
+#!/bin/bash
+
+# Split the assembly SDCC made of a C file into one module per function.
+#
+# Usage:
+#   cdtc_split_asm.sh FILE.asm DIR
+#
+# SDCC gives a C file one module, and its linker keeps or drops modules
+# as a whole: cdtc_relgc alone cannot leave out one unused function.
+# This writes DIR/MODULE.s and DIR/LABEL.s for each global label in
+# area _CODE, and prints their names, for sdasz80 -g (undefined symbols
+# are external).  Each global label in _CODE (a function, or a constant
+# table) starts a module of its own, up to the next one or to a switch
+# to another area.  The rest (variables, initializers, code before the
+# first global label) stays in DIR/MODULE.s, named after the C file.
+#
+# Labels that are not global (static functions and variables, string
+# literals) but are used from another module become global, renamed
+# NAME$MODULE so that those of two C files do not clash.  ".globl"
+# lines only stay for labels that a module defines: the others would
+# make it refer to every symbol of the C file.  Equates ("NAME = VALUE")
+# are copied to each module.
+#
+# With fewer than two global labels in _CODE, the file is copied to
+# DIR/MODULE.s unchanged.
+
+set -eu -o pipefail
+
+if [[ $# -ne 2 ]]
+then
+    echo >&2 "Usage: $0 FILE.asm DIR"
+    exit 2
+fi
+
+ASM="$1"
+DIR="$2"
+
+rm -rf "$DIR"
+mkdir -p "$DIR"
+
+# The file is read three times: labels and the module of each line,
+# labels used from another module, then the modules are written.
+LC_ALL=C awk -v dir="$DIR" '
+# The line without its comment, if any.
+function code(line,   i, c, quoted)
+{
+    quoted = 0
+    for (i = 1; i <= length(line); i++)
+    {
+        c = substr(line, i, 1)
+        if (c == "\"")
+            quoted = !quoted
+        else if (c == ";" && !quoted)
+            return substr(line, 1, i - 1)
+    }
+    return line
+}
+
+# The line with the renamed labels renamed.
+function rename_in(line,   out, c, rest, tok)
+{
+    out = ""
+    c = code(line)
+    rest = substr(line, length(c) + 1)
+    while (match(c, /[A-Za-z_.][A-Za-z0-9_.$]*/))
+    {
+        tok = substr(c, RSTART, RLENGTH)
+        # Local labels (00101$) and numbers are not symbols.
+        if (RSTART > 1 && substr(c, RSTART - 1, 1) ~ /[0-9$]/)
+            out = out substr(c, 1, RSTART + RLENGTH - 1)
+        else
+            out = out substr(c, 1, RSTART - 1) (tok in renamed ? renamed[tok] : tok)
+        c = substr(c, RSTART + RLENGTH)
+    }
+    return out c rest
+}
+
+FNR == 1 { pass++ ; area = "" ; piece = 0 }
+
+{
+    c = code($0)
+    label = ""
+    if (match(c, /^[A-Za-z_.][A-Za-z0-9_.$]*::?/))
+        label = substr(c, 1, RLENGTH)
+}
+
+pass == 1 {
+    if (c ~ /^[ \t]*\.module[ \t]/)
+    {
+        split(c, f)
+        module = f[2]
+    }
+    else if (c ~ /^[ \t]*\.area[ \t]/)
+    {
+        split(c, f)
+        area = f[2]
+        if (area != "_CODE")
+            piece = 0
+    }
+    else if (c ~ /^[ \t]*[A-Za-z_.][A-Za-z0-9_.$]*[ \t]*=[^=]/)
+        equates = equates $0 "\n"
+    if (label ~ /::$/)
+    {
+        name = substr(label, 1, length(label) - 2)
+        if (area == "_CODE")
+            piece = ++pieces
+        global[name] = 1
+        defined[name] = piece
+    }
+    else if (label != "")
+        defined[substr(label, 1, length(label) - 1)] = piece
+    # Comments go with the line that follows them, e.g. the function
+    # header with the function.
+    if (c ~ /^[ \t]*$/)
+        pending = pending " " FNR
+    else
+    {
+        n = split(pending, f)
+        for (i = 1; i <= n; i++)
+            piece_of[f[i]] = piece
+        pending = ""
+        piece_of[FNR] = piece
+    }
+    if (label ~ /::$/ && area == "_CODE")
+        file_of[piece] = name
+    next
+}
+
+pass == 2 {
+    if (pieces < 2)
+        next
+    p = piece_of[FNR]
+    while (match(c, /[A-Za-z_.][A-Za-z0-9_.$]*/))
+    {
+        tok = substr(c, RSTART, RLENGTH)
+        if ((RSTART == 1 || substr(c, RSTART - 1, 1) !~ /[0-9$]/) && (tok in defined) && !(tok in global) && defined[tok] != p)
+            renamed[tok] = tok "$" module
+        c = substr(c, RSTART + RLENGTH)
+    }
+    next
+}
+
+pass == 3 && FNR == 1 {
+    if (pieces < 2)
+    {
+        out[0] = dir "/" module ".s"
+        print $0 >out[0]
+        while ((getline line) > 0)
+            print line >out[0]
+        print out[0]
+        exit
+    }
+    for (p = 0; p <= pieces; p++)
+    {
+        out[p] = dir "/" (p == 0 ? module : file_of[p]) ".s"
+        printf "\t.module %s\n\t.optsdcc -mz80\n%s", (p == 0 ? module : module "$" file_of[p]), equates >out[p]
+        if (p > 0)
+            printf "\t.area _CODE\n" >out[p]
+    }
+}
+
+pass == 3 {
+    p = piece_of[FNR]
+    if (c ~ /^[ \t]*\.(module|optsdcc)[ \t]/)
+        next
+    if (c ~ /^[ \t]*[A-Za-z_.][A-Za-z0-9_.$]*[ \t]*=[^=]/)
+        next
+    if (c ~ /^[ \t]*\.globl[ \t]/)
+    {
+        split(c, f)
+        if (!(f[2] in defined) || (f[2] in global) || (f[2] in renamed))
+            next
+        p = defined[f[2]]
+    }
+    line = rename_in($0)
+    # A renamed label is now used from another module: make it global.
+    if (label != "" && label !~ /::$/ && substr(label, 1, length(label) - 1) in renamed)
+        sub(/:/, "::", line)
+    print line >out[p]
+}
+
+END {
+    if (pass == 3 && pieces >= 2)
+        for (p = 0; p <= pieces; p++)
+            print out[p]
+}
+' "$ASM" "$ASM" "$ASM"
@@ -0,0 +1,717 @@
+/*
+ * cdtc_sim: run Z80 code on the host and count its cycles.
+ *
+ * Memory is a flat 64K.  Code and data are loaded from .ihx files or
+ * raw binaries, then either a routine is called (it returns to a
+ * sentinel address and the run stops there) or execution starts at an
+ * address and runs until HALT.  Arguments are pushed on the stack the
+ * way SDCC passes them.
+ *
+ * At the end the number of instructions, Z80 T-states and CPC NOPs
+ * (microseconds, wait states included) is printed, and memory ranges
+ * can be dumped to files to check the results.
+ *
+ * With --bench, calls to cdtc_bench_begin and cdtc_bench_end (see
+ * cpclib/cdtc_bench) delimit regions, whose cycles are written to a
+ * file.
+ *
+ * With --probe, what the program writes to the probe port (see
+ * cpclib/cdtc_probe) is recorded in a file, for tool/cdtc_probe.
+ *
+ * With --profile, the PC is sampled at a fixed interval, optionally
+ * with the call stack, for tool/cdtc_profile.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "z80.h"
+
+#define SENTINEL 0x0000
+#define DEFAULT_SP 0xc000
+#define DEFAULT_MAX_T 1000000000ULL
+#define DEFAULT_EVERY 100
+
+static const char *progname = "cdtc_sim";
+
+static uint8_t memory[0x10000];
+
+static void
+die (const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start (ap, fmt);
+	fprintf (stderr, "%s: ", progname);
+	vfprintf (stderr, fmt, ap);
+	fputc ('\n', stderr);
+	va_end (ap);
+	exit (1);
+}
+
+/************************************************************************
+ * Input
+ ************************************************************************/
+
+static int
+hex_value (const char *s, int digits)
+{
+	int v = 0;
+
+	while (digits-- > 0)
+	{
+		int c = *s++;
+
+		v <<= 4;
+		if (c >= '0' && c <= '9')
+			v |= c - '0';
+		else if (c >= 'A' && c <= 'F')
+			v |= c - 'A' + 10;
+		else if (c >= 'a' && c <= 'f')
+			v |= c - 'a' + 10;
+		else
+			return -1;
+	}
+	return v;
+}
+
+static void
+load_ihx (const char *filename)
+{
+	char line[600];
+	unsigned int lineno = 0;
+	FILE *f = fopen (filename, "r");
+
+	if (f == NULL)
+		die ("%s: %s", filename, strerror (errno));
+	while (fgets (line, sizeof (line), f) != NULL)
+	{
+		int count, address, type, i, sum;
+
+		lineno++;
+		if (line[0] != ':')
+			continue;
+		count = hex_value (line + 1, 2);
+		address = hex_value (line + 3, 4);
+		type = hex_value (line + 7, 2);
+		if (count < 0 || address < 0 || type < 0
+		    || strlen (line) < (size_t) (11 + 2 * count))
+			die ("%s:%u: malformed record", filename, lineno);
+		sum = count + (address >> 8) + (address & 0xff) + type;
+		for (i = 0; i <= count; i++)
+		{
+			int byte = hex_value (line + 9 + 2 * i, 2);
+
+			if (byte < 0)
+				die ("%s:%u: malformed record", filename, lineno);
+			sum += byte;
+			if (i < count && type == 0)
+				memory[(address + i) & 0xffff] = byte;
+		}
+		if ((sum & 0xff) != 0)
+			die ("%s:%u: bad checksum", filename, lineno);
+		if (type == 1)
+			break;
+	}
+	fclose (f);
+}
+
+static void
+load_binary (const char *filename, unsigned int address)
+{
+	FILE *f = fopen (filename, "rb");
+	size_t n;
+
+	if (f == NULL)
+		die ("%s: %s", filename, strerror (errno));
+	n = fread (memory + address, 1, sizeof (memory) - address, f);
+	if (ferror (f))
+		die ("%s: %s", filename, strerror (errno));
+	if (fgetc (f) != EOF)
+		die ("%s: does not fit in memory at &%04X", filename, address);
+	fclose (f);
+	printf ("%s: %s: &%04X-&%04X (%u bytes)\n", progname, filename,
+		address, (unsigned int) (address + n - 1), (unsigned int) n);
+}
+
+/* Look up a global symbol in an aslink map file, see cdtc_pack. */
+static int
+map_lookup (const char *mapname, const char *symbol, unsigned int *value)
+{
+	char line[512];
+	FILE *f = fopen (mapname, "r");
+	int found = 0;
+
+	if (f == NULL)
+		die ("%s: %s", mapname, strerror (errno));
+	while (!found && fgets (line, sizeof (line), f) != NULL)
+	{
+		char *tok[3];
+		int n = 0;
+		char *p = strtok (line, " \t\r\n");
+
+		while (p != NULL && n < 3)
+		{
+			tok[n++] = p;
+			p = strtok (NULL, " \t\r\n");
+		}
+		if (n >= 1 && strlen (tok[0]) == 2 && tok[0][1] == ':')
+			memmove (tok, tok + 1, --n * sizeof (tok[0]));
+		if (n >= 2 && strcmp (tok[1], symbol) == 0
+		    && strlen (tok[0]) == 8
+		    && strspn (tok[0], "0123456789ABCDEFabcdef") == 8)
+		{
+			*value = strtoul (tok[0], NULL, 16) & 0xffff;
+			found = 1;
+		}
+	}
+	fclose (f);
+	return found;
+}
+
+/* &hex, $hex, #hex, 0xhex, decimal, or a symbol of the map files. */
+static unsigned int
+parse_value (const char *s, char **maps, int nmaps)
+{
+	const char *digits = s;
+	char *end;
+	unsigned long v;
+	int base = 10, i;
+
+	if (s[0] == '&' || s[0] == '$' || s[0] == '#')
+	{
+		digits = s + 1;
+		base = 16;
+	}
+	else if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+	{
+		digits = s + 2;
+		base = 16;
+	}
+	if (*digits != '\0')
+	{
+		errno = 0;
+		v = strtoul (digits, &end, base);
+		if (*end == '\0' && errno == 0)
+		{
+			if (v > 0xffff)
+				die ("%s: out of range", s);
+			return v;
+		}
+	}
+	for (i = 0; i < nmaps; i++)
+	{
+		unsigned int value;
+
+		if (map_lookup (maps[i], s, &value))
+			return value;
+	}
+	die ("%s: not a number nor a known symbol", s);
+	return 0;
+}
+
+/************************************************************************
+ * Benchmark regions
+ ************************************************************************/
+
+#define MAX_NESTING 32
+
+struct region
+{
+	unsigned long long count;
+	uint64_t t, cpc_t;	/* totals */
+	uint64_t min_cpc_t, max_cpc_t;
+};
+
+static struct region regions[256];
+
+static struct
+{
+	uint8_t region;
+	uint64_t t, cpc_t;
+} open_regions[MAX_NESTING];
+static int nopen;
+
+/* At cdtc_bench_begin: the region starts once its ret has run. */
+static void
+bench_begin_region (struct z80 *cpu)
+{
+	if (nopen == MAX_NESTING)
+		die ("more than %d nested benchmark regions", MAX_NESTING);
+	open_regions[nopen].region = cpu->l;
+	z80_step (cpu);
+	open_regions[nopen].t = cpu->t;
+	open_regions[nopen].cpc_t = cpu->cpc_t;
+	nopen++;
+}
+
+/* At cdtc_bench_end: the region ended before the instruction that got
+   here (a call, or a jp for a tail call), LAST_T and LAST_CPC_T are the
+   counters then.  So the markers do not count. */
+static void
+bench_end_region (const struct z80 *cpu, uint64_t last_t, uint64_t last_cpc_t)
+{
+	struct region *r;
+	uint64_t cpc_t;
+
+	if (nopen == 0)
+		die ("cdtc_bench_end at &%04X without cdtc_bench_begin", cpu->pc);
+	nopen--;
+	r = &regions[open_regions[nopen].region];
+	cpc_t = last_cpc_t - open_regions[nopen].cpc_t;
+	if (r->count == 0 || cpc_t < r->min_cpc_t)
+		r->min_cpc_t = cpc_t;
+	if (r->count == 0 || cpc_t > r->max_cpc_t)
+		r->max_cpc_t = cpc_t;
+	r->count++;
+	r->t += last_t - open_regions[nopen].t;
+	r->cpc_t += cpc_t;
+}
+
+/* One line per region that ran: its number, how many times, then
+   T-states and NOPs per run (the average if it ran more than once) and
+   the least and most NOPs of a run. */
+static void
+write_bench (const char *filename)
+{
+	FILE *f = fopen (filename, "w");
+	unsigned int i;
+
+	if (f == NULL)
+		die ("%s: %s", filename, strerror (errno));
+	fprintf (f, "%-6s %8s %10s %10s %10s %10s\n",
+		 "region", "runs", "T-states", "NOPs", "min NOPs", "max NOPs");
+	for (i = 0; i < 256; i++)
+	{
+		const struct region *r = &regions[i];
+
+		if (r->count == 0)
+			continue;
+		fprintf (f, "%-6u %8llu %10llu %10llu %10llu %10llu\n", i, r->count,
+			 (unsigned long long) ((r->t + r->count / 2) / r->count),
+			 (unsigned long long) ((r->cpc_t / 4 + r->count / 2) / r->count),
+			 (unsigned long long) (r->min_cpc_t / 4),
+			 (unsigned long long) (r->max_cpc_t / 4));
+	}
+	if (nopen > 0)
+		fprintf (f, "# %d region(s) not ended, first %u\n", nopen, open_regions[0].region);
+	if (ferror (f) || fclose (f) != 0)
+		die ("%s: %s", filename, strerror (errno));
+}
+
+/************************************************************************
+ * Probe port
+ ************************************************************************/
+
+#define PROBE_PORT_HIGH 0xff
+#define PROBE_RECORD_SIZE 6
+
+static FILE *probe;
+static const char *probe_name;
+
+/* Each OUT to a port &FFxx gives a record: the NOPs since the start, 32
+   bits, least significant byte first, then the low byte of the port and
+   the value written.  tool/cdtc_probe decodes them. */
+static void
+probe_out (void *ctx, uint16_t port, uint8_t value)
+{
+	const struct z80 *cpu = ctx;
+	uint32_t nops = cpu->cpc_t / 4;
+	uint8_t record[PROBE_RECORD_SIZE];
+
+	if ((port >> 8) != PROBE_PORT_HIGH)
+		return;
+	record[0] = nops & 0xff;
+	record[1] = (nops >> 8) & 0xff;
+	record[2] = (nops >> 16) & 0xff;
+	record[3] = (nops >> 24) & 0xff;
+	record[4] = port & 0xff;
+	record[5] = value;
+	if (fwrite (record, PROBE_RECORD_SIZE, 1, probe) != 1)
+		die ("%s: %s", probe_name, strerror (errno));
+}
+
+/************************************************************************
+ * Profile
+ ************************************************************************/
+
+#define MAX_FRAMES 64
+
+/* Calls seen so far and not returned from: where each went, and SP
+   right after it pushed its return address.  A frame is gone once SP
+   is above that, whether by RET or not.  The first frame is where the
+   run started. */
+static struct
+{
+	uint16_t entry;
+	uint16_t sp;
+} frames[MAX_FRAMES];
+static int nframes, frames_lost;
+
+static FILE *profile;
+static const char *profile_name;
+static int profile_stacks;
+
+static void
+profile_start (const struct z80 *cpu)
+{
+	frames[0].entry = cpu->pc;
+	frames[0].sp = cpu->sp;
+	nframes = 1;
+}
+
+/* One line per sample, addresses in hex: with --stacks the entry of
+   each frame, outermost first, then the PC. */
+static void
+profile_sample (uint16_t pc)
+{
+	int i;
+
+	if (profile_stacks)
+		for (i = 0; i < nframes; i++)
+			fprintf (profile, "%04X ", frames[i].entry);
+	fprintf (profile, "%04X\n", pc);
+}
+
+/* After the instruction at PC ran with SP before it: push a frame if it
+   was a CALL or RST that was taken, pop those it returned from. */
+static void
+profile_track (const struct z80 *cpu, uint16_t pc, uint16_t sp)
+{
+	uint8_t op = z80_peek (cpu, pc);
+	unsigned int length = 0;
+	uint16_t sp_after = sp - 2;
+
+	if (op == 0xcd || (op & 0xc7) == 0xc4)
+		length = 3;	/* CALL nn, CALL cc,nn */
+	else if ((op & 0xc7) == 0xc7)
+		length = 1;	/* RST */
+	if (length != 0 && cpu->sp == sp_after
+	    && (z80_peek (cpu, sp_after) | z80_peek (cpu, sp_after + 1) << 8) == (uint16_t) (pc + length))
+	{
+		if (nframes == MAX_FRAMES)
+			frames_lost = 1;
+		else
+		{
+			frames[nframes].entry = cpu->pc;
+			frames[nframes].sp = cpu->sp;
+			nframes++;
+		}
+		return;
+	}
+	while (nframes > 1 && cpu->sp > frames[nframes - 1].sp)
+		nframes--;
+}
+
+/************************************************************************
+ * Main
+ ************************************************************************/
+
+static void
+usage (FILE *f)
+{
+	fprintf (f,
+		 "Usage: %s [options]\n"
+		 "  -l, --load FILE[@ADDR]  load an .ihx, or a raw binary at ADDR, may be repeated\n"
+		 "  -m, --map FILE          linker map file, for symbols, may be repeated\n"
+		 "  -c, --call SYM|ADDR     call a routine, stop when it returns\n"
+		 "  -j, --jump SYM|ADDR     start there, stop on HALT\n"
+		 "  -a, --arg VALUE         16-bit argument of --call, first one first\n"
+		 "  -b, --byte-arg VALUE    8-bit argument of --call\n"
+		 "  -r, --reg REG=VALUE     initial register: a bc de hl ix iy\n"
+		 "  -s, --sp ADDR           initial stack pointer (default &%04X)\n"
+		 "  -t, --max-t N           give up after N T-states (default %llu)\n"
+		 "  -d, --dump ADDR:LEN:FILE  write memory to FILE after the run, may be repeated\n"
+		 "  -B, --bench FILE        write the cycles of cdtc_bench regions to FILE\n"
+		 "  -P, --probe FILE        record writes to the probe port (&FFxx) in FILE\n"
+		 "  -p, --profile FILE      sample the PC into FILE\n"
+		 "  -e, --every N           sample every N NOPs (default %u)\n"
+		 "  -k, --stacks            sample the call stack too\n"
+		 "  -h, --help\n"
+		 "Values are &hex, $hex, #hex, 0xhex, decimal or map symbols.\n",
+		 progname, DEFAULT_SP, DEFAULT_MAX_T, DEFAULT_EVERY);
+}
+
+struct arg
+{
+	int is_byte;
+	const char *text;
+};
+
+static void
+set_register (struct z80 *cpu, const char *name, unsigned int v)
+{
+	if (strcmp (name, "a") == 0)
+		cpu->a = v;
+	else if (strcmp (name, "bc") == 0)
+	{
+		cpu->b = v >> 8;
+		cpu->c = v;
+	}
+	else if (strcmp (name, "de") == 0)
+	{
+		cpu->d = v >> 8;
+		cpu->e = v;
+	}
+	else if (strcmp (name, "hl") == 0)
+	{
+		cpu->h = v >> 8;
+		cpu->l = v;
+	}
+	else if (strcmp (name, "ix") == 0)
+		cpu->ix = v;
+	else if (strcmp (name, "iy") == 0)
+		cpu->iy = v;
+	else
+		die ("unknown register %s", name);
+}
+
+int
+main (int argc, char **argv)
+{
+	static const struct option options[] = {
+		{"load", required_argument, NULL, 'l'},
+		{"map", required_argument, NULL, 'm'},
+		{"call", required_argument, NULL, 'c'},
+		{"jump", required_argument, NULL, 'j'},
+		{"arg", required_argument, NULL, 'a'},
+		{"byte-arg", required_argument, NULL, 'b'},
+		{"reg", required_argument, NULL, 'r'},
+		{"sp", required_argument, NULL, 's'},
+		{"max-t", required_argument, NULL, 't'},
+		{"dump", required_argument, NULL, 'd'},
+		{"bench", required_argument, NULL, 'B'},
+		{"probe", required_argument, NULL, 'P'},
+		{"profile", required_argument, NULL, 'p'},
+		{"every", required_argument, NULL, 'e'},
+		{"stacks", no_argument, NULL, 'k'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0}
+	};
+	static struct z80 cpu;
+	char **loads = calloc (argc, sizeof (char *));
+	char **maps = calloc (argc, sizeof (char *));
+	char **regs = calloc (argc, sizeof (char *));
+	char **dumps = calloc (argc, sizeof (char *));
+	struct arg *args = calloc (argc, sizeof (struct arg));
+	int nloads = 0, nmaps = 0, nregs = 0, ndumps = 0, nargs = 0, opt, i;
+	const char *call = NULL, *jump = NULL, *sp = NULL, *bench = NULL, *outcome;
+	unsigned long long max_t = DEFAULT_MAX_T;
+	unsigned int return_sp, bench_begin = 0x10000, bench_end = 0x10000;
+	uint64_t last_t = 0, last_cpc_t = 0, next_sample = 0;
+	unsigned long every = DEFAULT_EVERY;
+
+	if (loads == NULL || maps == NULL || regs == NULL || dumps == NULL || args == NULL)
+		die ("out of memory");
+
+	while ((opt = getopt_long (argc, argv, "l:m:c:j:a:b:r:s:t:d:B:P:p:e:kh", options, NULL)) != -1)
+	{
+		switch (opt)
+		{
+		case 'l': loads[nloads++] = optarg; break;
+		case 'm': maps[nmaps++] = optarg; break;
+		case 'c': call = optarg; break;
+		case 'j': jump = optarg; break;
+		case 'a':
+		case 'b':
+			args[nargs].text = optarg;
+			args[nargs++].is_byte = (opt == 'b');
+			break;
+		case 'r': regs[nregs++] = optarg; break;
+		case 's': sp = optarg; break;
+		case 't': max_t = strtoull (optarg, NULL, 0); break;
+		case 'd': dumps[ndumps++] = optarg; break;
+		case 'B': bench = optarg; break;
+		case 'P': probe_name = optarg; break;
+		case 'p': profile_name = optarg; break;
+		case 'e':
+			every = strtoul (optarg, NULL, 0);
+			if (every == 0)
+				die ("sampling interval must be at least 1 NOP");
+			break;
+		case 'k': profile_stacks = 1; break;
+		case 'h': usage (stdout); return 0;
+		default: usage (stderr); return 1;
+		}
+	}
+	if (optind != argc || (call == NULL) == (jump == NULL))
+	{
+		usage (stderr);
+		return 1;
+	}
+
+	z80_init (&cpu, memory);
+
+	for (i = 0; i < nloads; i++)
+	{
+		char *at = strrchr (loads[i], '@');
+
+		if (at != NULL)
+		{
+			*at = '\0';
+			load_binary (loads[i], parse_value (at + 1, maps, nmaps));
+		}
+		else
+			load_ihx (loads[i]);
+	}
+
+	cpu.sp = sp ? parse_value (sp, maps, nmaps) : DEFAULT_SP;
+	for (i = 0; i < nregs; i++)
+	{
+		char *eq = strchr (regs[i], '=');
+
+		if (eq == NULL)
+			die ("%s: expected REG=VALUE", regs[i]);
+		*eq = '\0';
+		set_register (&cpu, regs[i], parse_value (eq + 1, maps, nmaps));
+	}
+
+	if (call != NULL)
+	{
+		/* SDCC pushes the last argument first, a byte argument
+		   takes a single byte of stack. */
+		for (i = nargs - 1; i >= 0; i--)
+		{
+			unsigned int v = parse_value (args[i].text, maps, nmaps);
+
+			if (args[i].is_byte)
+			{
+				if (v > 0xff)
+					die ("%s: does not fit in a byte", args[i].text);
+				cpu.sp--;
+				z80_poke (&cpu, cpu.sp, v);
+			}
+			else
+			{
+				cpu.sp -= 2;
+				z80_poke (&cpu, cpu.sp, v & 0xff);
+				z80_poke (&cpu, cpu.sp + 1, v >> 8);
+			}
+		}
+		return_sp = cpu.sp;
+		cpu.sp -= 2;
+		z80_poke (&cpu, cpu.sp, SENTINEL & 0xff);
+		z80_poke (&cpu, cpu.sp + 1, SENTINEL >> 8);
+		cpu.pc = parse_value (call, maps, nmaps);
+	}
+	else
+	{
+		return_sp = 0x10000;
+		cpu.pc = parse_value (jump, maps, nmaps);
+	}
+
+	if (probe_name != NULL)
+	{
+		probe = fopen (probe_name, "wb");
+		if (probe == NULL)
+			die ("%s: %s", probe_name, strerror (errno));
+		cpu.out = probe_out;
+		cpu.ctx = &cpu;
+	}
+
+	if (profile_name != NULL)
+	{
+		profile = fopen (profile_name, "w");
+		if (profile == NULL)
+			die ("%s: %s", profile_name, strerror (errno));
+		profile_start (&cpu);
+		next_sample = every * 4;
+	}
+
+	if (bench != NULL)
+	{
+		bench_begin = parse_value ("_cdtc_bench_begin", maps, nmaps);
+		bench_end = parse_value ("_cdtc_bench_end", maps, nmaps);
+	}
+
+	for (;;)
+	{
+		if (cpu.pc == SENTINEL && cpu.sp == return_sp)
+		{
+			outcome = "returned";
+			break;
+		}
+		if (cpu.halted)
+		{
+			outcome = "halted";
+			break;
+		}
+		if (cpu.t >= max_t)
+		{
+			outcome = "gave up";
+			break;
+		}
+		if (cpu.pc == bench_begin)
+		{
+			bench_begin_region (&cpu);
+			continue;
+		}
+		if (cpu.pc == bench_end)
+			bench_end_region (&cpu, last_t, last_cpc_t);
+		last_t = cpu.t;
+		last_cpc_t = cpu.cpc_t;
+		if (profile != NULL)
+		{
+			uint16_t pc = cpu.pc, sp = cpu.sp;
+
+			z80_step (&cpu);
+			/* The instruction running when the interval ended. */
+			for (; cpu.cpc_t >= next_sample; next_sample += every * 4)
+				profile_sample (pc);
+			profile_track (&cpu, pc, sp);
+		}
+		else
+			z80_step (&cpu);
+	}
+
+	printf ("%s: %s at &%04X after %llu instructions, %llu T-states, %llu NOPs\n",
+		progname, outcome, cpu.pc, (unsigned long long) cpu.instructions,
+		(unsigned long long) cpu.t, (unsigned long long) (cpu.cpc_t / 4));
+	printf ("%s: A=%02X F=%02X BC=%02X%02X DE=%02X%02X HL=%02X%02X IX=%04X IY=%04X SP=%04X\n",
+		progname, cpu.a, cpu.f, cpu.b, cpu.c, cpu.d, cpu.e, cpu.h, cpu.l,
+		cpu.ix, cpu.iy, cpu.sp);
+
+	if (bench != NULL)
+		write_bench (bench);
+	if (probe != NULL && fclose (probe) != 0)
+		die ("%s: %s", probe_name, strerror (errno));
+	if (profile != NULL)
+	{
+		if (frames_lost)
+			fprintf (stderr, "%s: calls nested deeper than %d, stacks are cut\n", progname, MAX_FRAMES);
+		if (ferror (profile) || fclose (profile) != 0)
+			die ("%s: %s", profile_name, strerror (errno));
+	}
+
+	for (i = 0; i < ndumps; i++)
+	{
+		char *first = strchr (dumps[i], ':');
+		char *second = first ? strchr (first + 1, ':') : NULL;
+		unsigned int address, length;
+		FILE *f;
+
+		if (second == NULL)
+			die ("%s: expected ADDR:LEN:FILE", dumps[i]);
+		*first = *second = '\0';
+		address = parse_value (dumps[i], maps, nmaps);
+		length = parse_value (first + 1, maps, nmaps);
+		if (address + length > sizeof (memory))
+			die ("dump beyond 64K");
+		f = fopen (second + 1, "wb");
+		if (f == NULL || fwrite (memory + address, 1, length, f) != length
+		    || fclose (f) != 0)
+			die ("%s: %s", second + 1, strerror (errno));
+	}
+
+	free (loads);
+	free (maps);
+	free (regs);
+	free (dumps);
+	free (args);
+	return strcmp (outcome, "gave up") == 0 ? 2 : 0;
+}
@@ -0,0 +1,1172 @@
+/*
+ * Z80 core, see z80.h.
+ *
+ * Opcodes are decoded with the usual x/y/z/p/q split of the opcode
+ * byte: x = bits 7-6, y = bits 5-3, z = bits 2-0, p = y >> 1, q = y & 1.
+ */
+
+#include "z80.h"
+
+#include <string.h>
+
+/* Index mode selected by a DD or FD prefix. */
+#define USE_HL 0
+#define USE_IX 1
+#define USE_IY 2
+
+static uint8_t sz53_table[256], sz53p_table[256];
+static int tables_ready;
+
+static void
+init_tables (void)
+{
+	int i, bit, parity;
+
+	for (i = 0; i < 256; i++)
+	{
+		sz53_table[i] = i & (Z80_SF | Z80_YF | Z80_XF);
+		if (i == 0)
+			sz53_table[i] |= Z80_ZF;
+		parity = 1;
+		for (bit = 0; bit < 8; bit++)
+			parity ^= (i >> bit) & 1;
+		sz53p_table[i] = sz53_table[i] | (parity ? Z80_PF : 0);
+	}
+	tables_ready = 1;
+}
+
+/************************************************************************
+ * Machine cycles
+ ************************************************************************/
+
+/* CPC: every access starts on a 4 T-state boundary. */
+static void
+cpc_align (struct z80 *cpu)
+{
+	cpu->cpc_t = (cpu->cpc_t + 3) & ~(uint64_t) 3;
+}
+
+static void
+internal (struct z80 *cpu, unsigned int t)
+{
+	cpu->t += t;
+	cpu->cpc_t += t;
+}
+
+uint8_t
+z80_peek (const struct z80 *cpu, uint16_t address)
+{
+	return cpu->read_page[address >> 14][address & (Z80_PAGE_SIZE - 1)];
+}
+
+void
+z80_poke (struct z80 *cpu, uint16_t address, uint8_t value)
+{
+	cpu->write_page[address >> 14][address & (Z80_PAGE_SIZE - 1)] = value;
+}
+
+static uint8_t
+fetch_opcode (struct z80 *cpu)
+{
+	cpc_align (cpu);
+	internal (cpu, 4);
+	cpu->r = (cpu->r & 0x80) | ((cpu->r + 1) & 0x7f);
+	return z80_peek (cpu, cpu->pc++);
+}
+
+static uint8_t
+read8 (struct z80 *cpu, uint16_t address)
+{
+	cpc_align (cpu);
+	internal (cpu, 3);
+	return z80_peek (cpu, address);
+}
+
+static void
+write8 (struct z80 *cpu, uint16_t address, uint8_t value)
+{
+	cpc_align (cpu);
+	internal (cpu, 3);
+	z80_poke (cpu, address, value);
+}
+
+static uint8_t
+fetch8 (struct z80 *cpu)
+{
+	return read8 (cpu, cpu->pc++);
+}
+
+static uint16_t
+fetch16 (struct z80 *cpu)
+{
+	uint16_t lo = fetch8 (cpu);
+
+	return lo | (fetch8 (cpu) << 8);
+}
+
+static uint16_t
+read16 (struct z80 *cpu, uint16_t address)
+{
+	uint16_t lo = read8 (cpu, address);
+
+	return lo | (read8 (cpu, address + 1) << 8);
+}
+
+static void
+write16 (struct z80 *cpu, uint16_t address, uint16_t value)
+{
+	write8 (cpu, address, value & 0xff);
+	write8 (cpu, address + 1, value >> 8);
+}
+
+static uint8_t
+io_read (struct z80 *cpu, uint16_t port)
+{
+	cpc_align (cpu);
+	internal (cpu, 4);
+	return cpu->in ? cpu->in (cpu->ctx, port) : 0xff;
+}
+
+static void
+io_write (struct z80 *cpu, uint16_t port, uint8_t value)
+{
+	cpc_align (cpu);
+	internal (cpu, 4);
+	if (cpu->out)
+		cpu->out (cpu->ctx, port, value);
+}
+
+static void
+push16 (struct z80 *cpu, uint16_t value)
+{
+	write8 (cpu, --cpu->sp, value >> 8);
+	write8 (cpu, --cpu->sp, value & 0xff);
+}
+
+static uint16_t
+pop16 (struct z80 *cpu)
+{
+	uint16_t lo = read8 (cpu, cpu->sp++);
+
+	return lo | (read8 (cpu, cpu->sp++) << 8);
+}
+
+/************************************************************************
+ * Registers
+ ************************************************************************/
+
+static uint16_t
+get_hl (const struct z80 *cpu, int idx)
+{
+	if (idx == USE_IX)
+		return cpu->ix;
+	if (idx == USE_IY)
+		return cpu->iy;
+	return (cpu->h << 8) | cpu->l;
+}
+
+static void
+set_hl (struct z80 *cpu, int idx, uint16_t v)
+{
+	if (idx == USE_IX)
+		cpu->ix = v;
+	else if (idx == USE_IY)
+		cpu->iy = v;
+	else
+	{
+		cpu->h = v >> 8;
+		cpu->l = v & 0xff;
+	}
+}
+
+/* rp table: BC DE HL SP */
+static uint16_t
+get_rp (const struct z80 *cpu, int p, int idx)
+{
+	switch (p)
+	{
+	case 0: return (cpu->b << 8) | cpu->c;
+	case 1: return (cpu->d << 8) | cpu->e;
+	case 2: return get_hl (cpu, idx);
+	default: return cpu->sp;
+	}
+}
+
+static void
+set_rp (struct z80 *cpu, int p, int idx, uint16_t v)
+{
+	switch (p)
+	{
+	case 0: cpu->b = v >> 8; cpu->c = v & 0xff; break;
+	case 1: cpu->d = v >> 8; cpu->e = v & 0xff; break;
+	case 2: set_hl (cpu, idx, v); break;
+	default: cpu->sp = v; break;
+	}
+}
+
+/* rp2 table: BC DE HL AF */
+static uint16_t
+get_rp2 (const struct z80 *cpu, int p, int idx)
+{
+	return p == 3 ? (cpu->a << 8) | cpu->f : get_rp (cpu, p, idx);
+}
+
+static void
+set_rp2 (struct z80 *cpu, int p, int idx, uint16_t v)
+{
+	if (p == 3)
+	{
+		cpu->a = v >> 8;
+		cpu->f = v & 0xff;
+	}
+	else
+		set_rp (cpu, p, idx, v);
+}
+
+/* r table: B C D E H L - A, (HL) is handled by callers.  With a DD or
+   FD prefix, H and L stand for the halves of IX or IY. */
+static uint8_t
+get_r (const struct z80 *cpu, int r, int idx)
+{
+	switch (r)
+	{
+	case 0: return cpu->b;
+	case 1: return cpu->c;
+	case 2: return cpu->d;
+	case 3: return cpu->e;
+	case 4: return get_hl (cpu, idx) >> 8;
+	case 5: return get_hl (cpu, idx) & 0xff;
+	default: return cpu->a;
+	}
+}
+
+static void
+set_r (struct z80 *cpu, int r, int idx, uint8_t v)
+{
+	switch (r)
+	{
+	case 0: cpu->b = v; break;
+	case 1: cpu->c = v; break;
+	case 2: cpu->d = v; break;
+	case 3: cpu->e = v; break;
+	case 4: set_hl (cpu, idx, (get_hl (cpu, idx) & 0x00ff) | (v << 8)); break;
+	case 5: set_hl (cpu, idx, (get_hl (cpu, idx) & 0xff00) | v); break;
+	default: cpu->a = v; break;
+	}
+}
+
+/* Address of the (HL), (IX+d) or (IY+d) operand.  extra is the number
+   of internal T-states after reading d. */
+static uint16_t
+operand_address (struct z80 *cpu, int idx, unsigned int extra)
+{
+	uint16_t address;
+
+	if (idx == USE_HL)
+		return get_hl (cpu, idx);
+	address = get_hl (cpu, idx) + (int8_t) fetch8 (cpu);
+	internal (cpu, extra);
+	cpu->wz = address;
+	return address;
+}
+
+static int
+condition (const struct z80 *cpu, int y)
+{
+	static const uint8_t mask[4] = { Z80_ZF, Z80_CF, Z80_PF, Z80_SF };
+	int set = (cpu->f & mask[y >> 1]) != 0;
+
+	return (y & 1) ? set : !set;
+}
+
+/************************************************************************
+ * Arithmetic and logic
+ ************************************************************************/
+
+static void
+alu (struct z80 *cpu, int op, uint8_t v)
+{
+	unsigned int a = cpu->a, r, carry = 0;
+
+	switch (op)
+	{
+	case 1: /* ADC */
+		carry = cpu->f & Z80_CF;
+		/* fall through */
+	case 0: /* ADD */
+		r = a + v + carry;
+		cpu->f = sz53_table[r & 0xff] | ((r >> 8) & Z80_CF)
+			| ((a ^ v ^ r) & Z80_HF)
+			| ((((a ^ ~v) & (a ^ r)) & 0x80) >> 5);
+		cpu->a = r;
+		break;
+	case 3: /* SBC */
+		carry = cpu->f & Z80_CF;
+		/* fall through */
+	case 2: /* SUB */
+	case 7: /* CP */
+		r = a - v - carry;
+		cpu->f = sz53_table[r & 0xff] | ((r >> 8) & Z80_CF) | Z80_NF
+			| ((a ^ v ^ r) & Z80_HF)
+			| ((((a ^ v) & (a ^ r)) & 0x80) >> 5);
+		if (op == 7)
+			cpu->f = (cpu->f & ~(Z80_XF | Z80_YF)) | (v & (Z80_XF | Z80_YF));
+		else
+			cpu->a = r;
+		break;
+	case 4: /* AND */
+		cpu->a &= v;
+		cpu->f = sz53p_table[cpu->a] | Z80_HF;
+		break;
+	case 5: /* XOR */
+		cpu->a ^= v;
+		cpu->f = sz53p_table[cpu->a];
+		break;
+	default: /* OR */
+		cpu->a |= v;
+		cpu->f = sz53p_table[cpu->a];
+		break;
+	}
+}
+
+static uint8_t
+inc8 (struct z80 *cpu, uint8_t v)
+{
+	uint8_t r = v + 1;
+
+	cpu->f = (cpu->f & Z80_CF) | sz53_table[r]
+		| ((r & 0x0f) == 0 ? Z80_HF : 0) | (v == 0x7f ? Z80_PF : 0);
+	return r;
+}
+
+static uint8_t
+dec8 (struct z80 *cpu, uint8_t v)
+{
+	uint8_t r = v - 1;
+
+	cpu->f = (cpu->f & Z80_CF) | sz53_table[r] | Z80_NF
+		| ((v & 0x0f) == 0 ? Z80_HF : 0) | (v == 0x80 ? Z80_PF : 0);
+	return r;
+}
+
+static uint16_t
+add16 (struct z80 *cpu, uint16_t a, uint16_t b)
+{
+	unsigned int r = a + b;
+
+	cpu->wz = a + 1;
+	cpu->f = (cpu->f & (Z80_SF | Z80_ZF | Z80_PF)) | ((r >> 16) & Z80_CF)
+		| (((a ^ b ^ r) >> 8) & Z80_HF) | ((r >> 8) & (Z80_XF | Z80_YF));
+	return r;
+}
+
+static uint16_t
+adc16 (struct z80 *cpu, uint16_t a, uint16_t b)
+{
+	unsigned int r = a + b + (cpu->f & Z80_CF);
+
+	cpu->wz = a + 1;
+	cpu->f = ((r >> 16) & Z80_CF) | ((r >> 8) & (Z80_SF | Z80_XF | Z80_YF))
+		| ((r & 0xffff) ? 0 : Z80_ZF) | (((a ^ b ^ r) >> 8) & Z80_HF)
+		| (((~(a ^ b) & (a ^ r)) & 0x8000) >> 13);
+	return r;
+}
+
+static uint16_t
+sbc16 (struct z80 *cpu, uint16_t a, uint16_t b)
+{
+	unsigned int r = a - b - (cpu->f & Z80_CF);
+
+	cpu->wz = a + 1;
+	cpu->f = Z80_NF | ((r >> 16) & Z80_CF) | ((r >> 8) & (Z80_SF | Z80_XF | Z80_YF))
+		| ((r & 0xffff) ? 0 : Z80_ZF) | (((a ^ b ^ r) >> 8) & Z80_HF)
+		| ((((a ^ b) & (a ^ r)) & 0x8000) >> 13);
+	return r;
+}
+
+/* CB prefixed rotations and shifts. */
+static uint8_t
+rot (struct z80 *cpu, int y, uint8_t v)
+{
+	uint8_t r, carry;
+
+	switch (y)
+	{
+	case 0: carry = v >> 7; r = (v << 1) | carry; break;		/* RLC */
+	case 1: carry = v & 1; r = (v >> 1) | (carry << 7); break;	/* RRC */
+	case 2: carry = v >> 7; r = (v << 1) | (cpu->f & Z80_CF); break;	/* RL */
+	case 3: carry = v & 1; r = (v >> 1) | ((cpu->f & Z80_CF) << 7); break;	/* RR */
+	case 4: carry = v >> 7; r = v << 1; break;			/* SLA */
+	case 5: carry = v & 1; r = (v >> 1) | (v & 0x80); break;	/* SRA */
+	case 6: carry = v >> 7; r = (v << 1) | 1; break;		/* SLL */
+	default: carry = v & 1; r = v >> 1; break;			/* SRL */
+	}
+	cpu->f = sz53p_table[r] | carry;
+	return r;
+}
+
+/* RLCA RRCA RLA RRA: like CB rotations, but S Z P are kept. */
+static void
+rot_a (struct z80 *cpu, int y)
+{
+	uint8_t keep = cpu->f & (Z80_SF | Z80_ZF | Z80_PF);
+
+	cpu->a = rot (cpu, y, cpu->a);
+	cpu->f = keep | (cpu->a & (Z80_XF | Z80_YF)) | (cpu->f & Z80_CF);
+}
+
+static void
+daa (struct z80 *cpu)
+{
+	uint8_t a = cpu->a, diff = 0, carry = cpu->f & Z80_CF, half;
+
+	if ((cpu->f & Z80_HF) || (a & 0x0f) > 9)
+		diff |= 0x06;
+	if (carry || a > 0x99)
+	{
+		diff |= 0x60;
+		carry = Z80_CF;
+	}
+	if (cpu->f & Z80_NF)
+	{
+		half = (cpu->f & Z80_HF) && (a & 0x0f) < 6;
+		cpu->a = a - diff;
+	}
+	else
+	{
+		half = (a & 0x0f) > 9;
+		cpu->a = a + diff;
+	}
+	cpu->f = sz53p_table[cpu->a] | carry | (cpu->f & Z80_NF) | (half ? Z80_HF : 0);
+}
+
+static void
+bit (struct z80 *cpu, int y, uint8_t v, uint8_t xy)
+{
+	uint8_t set = v & (1 << y);
+
+	cpu->f = (cpu->f & Z80_CF) | Z80_HF | (xy & (Z80_XF | Z80_YF))
+		| (set ? 0 : Z80_ZF | Z80_PF) | ((y == 7 && set) ? Z80_SF : 0);
+}
+
+/************************************************************************
+ * Prefixed opcodes
+ ************************************************************************/
+
+static void
+execute_cb (struct z80 *cpu, int idx)
+{
+	uint16_t address = 0;
+	uint8_t op, v;
+	int x, y, z;
+
+	if (idx != USE_HL)
+	{
+		/* DD CB d op: d and op are read as data, not fetched. */
+		address = operand_address (cpu, idx, 0);
+		op = fetch8 (cpu);
+		internal (cpu, 2);
+	}
+	else
+		op = fetch_opcode (cpu);
+	x = op >> 6;
+	y = (op >> 3) & 7;
+	z = op & 7;
+
+	if (idx == USE_HL && z != 6)
+	{
+		v = get_r (cpu, z, USE_HL);
+		switch (x)
+		{
+		case 0: set_r (cpu, z, USE_HL, rot (cpu, y, v)); break;
+		case 1: bit (cpu, y, v, v); break;
+		case 2: set_r (cpu, z, USE_HL, v & ~(1 << y)); break;
+		default: set_r (cpu, z, USE_HL, v | (1 << y)); break;
+		}
+		return;
+	}
+
+	if (idx == USE_HL)
+		address = get_hl (cpu, USE_HL);
+	v = read8 (cpu, address);
+	internal (cpu, 1);
+	switch (x)
+	{
+	case 0: v = rot (cpu, y, v); break;
+	case 1: bit (cpu, y, v, idx == USE_HL ? cpu->wz >> 8 : address >> 8); return;
+	case 2: v &= ~(1 << y); break;
+	default: v |= 1 << y; break;
+	}
+	write8 (cpu, address, v);
+	/* Undocumented: DD CB copies the result to a register too. */
+	if (idx != USE_HL && z != 6)
+		set_r (cpu, z, USE_HL, v);
+}
+
+static void
+block_instruction (struct z80 *cpu, int y, int z)
+{
+	int decrement = y & 1, repeat = y & 2;
+	uint16_t hl = get_hl (cpu, USE_HL);
+	uint16_t de = get_rp (cpu, 1, USE_HL);
+	uint16_t bc = get_rp (cpu, 0, USE_HL);
+	int step = decrement ? -1 : 1;
+	uint8_t v;
+
+	switch (z)
+	{
+	case 0: /* LDI LDD LDIR LDDR */
+	{
+		uint8_t n;
+
+		v = read8 (cpu, hl);
+		write8 (cpu, de, v);
+		internal (cpu, 2);
+		set_hl (cpu, USE_HL, hl + step);
+		set_rp (cpu, 1, USE_HL, de + step);
+		set_rp (cpu, 0, USE_HL, --bc);
+		n = v + cpu->a;
+		cpu->f = (cpu->f & (Z80_SF | Z80_ZF | Z80_CF)) | (bc ? Z80_PF : 0)
+			| (n & Z80_XF) | ((n << 4) & Z80_YF);
+		if (repeat && bc)
+		{
+			internal (cpu, 5);
+			cpu->pc -= 2;
+			cpu->wz = cpu->pc + 1;
+		}
+		break;
+	}
+	case 1: /* CPI CPD CPIR CPDR */
+	{
+		uint8_t r, n;
+		int half;
+
+		v = read8 (cpu, hl);
+		internal (cpu, 5);
+		r = cpu->a - v;
+		half = ((cpu->a ^ v ^ r) & Z80_HF) != 0;
+		n = r - half;
+		set_hl (cpu, USE_HL, hl + step);
+		set_rp (cpu, 0, USE_HL, --bc);
+		cpu->wz += step;
+		cpu->f = (cpu->f & Z80_CF) | Z80_NF | (sz53_table[r] & ~(Z80_XF | Z80_YF))
+			| (half ? Z80_HF : 0) | (bc ? Z80_PF : 0)
+			| (n & Z80_XF) | ((n << 4) & Z80_YF);
+		if (repeat && bc && r != 0)
+		{
+			internal (cpu, 5);
+			cpu->pc -= 2;
+			cpu->wz = cpu->pc + 1;
+		}
+		break;
+	}
+	case 2: /* INI IND INIR INDR */
+	case 3: /* OUTI OUTD OTIR OTDR */
+	{
+		unsigned int k;
+
+		if (z == 2)
+		{
+			internal (cpu, 1);
+			v = io_read (cpu, bc);
+			write8 (cpu, hl, v);
+			cpu->wz = bc + step;
+			cpu->b--;
+			k = v + ((cpu->c + step) & 0xff);
+		}
+		else
+		{
+			v = read8 (cpu, hl);
+			cpu->b--;
+			cpu->wz = ((cpu->b << 8) | cpu->c) + step;
+			io_write (cpu, (cpu->b << 8) | cpu->c, v);
+			/* Counted here, this gives the usual CPC timings. */
+			internal (cpu, 1);
+			k = v + ((hl + step) & 0xff);
+		}
+		set_hl (cpu, USE_HL, hl + step);
+		cpu->f = sz53_table[cpu->b] | ((v & 0x80) ? Z80_NF : 0)
+			| (k > 255 ? Z80_HF | Z80_CF : 0)
+			| (sz53p_table[(k & 7) ^ cpu->b] & Z80_PF);
+		if (repeat && cpu->b)
+		{
+			internal (cpu, 5);
+			cpu->pc -= 2;
+		}
+		break;
+	}
+	}
+}
+
+static void
+execute_ed (struct z80 *cpu)
+{
+	uint8_t op = fetch_opcode (cpu);
+	int x = op >> 6, y = (op >> 3) & 7, z = op & 7, p = y >> 1, q = y & 1;
+	uint16_t bc = get_rp (cpu, 0, USE_HL);
+
+	if (x == 2 && y >= 4 && z <= 3)
+	{
+		block_instruction (cpu, y - 4, z);
+		return;
+	}
+	if (x != 1)
+		return;		/* invalid, acts as two NOPs */
+
+	switch (z)
+	{
+	case 0: /* IN r,(C) */
+	{
+		uint8_t v = io_read (cpu, bc);
+
+		/* The CPC inserts one more wait state on IN/OUT (C). */
+		cpu->cpc_t += 4;
+		cpu->wz = bc + 1;
+		if (y != 6)
+			set_r (cpu, y, USE_HL, v);
+		cpu->f = (cpu->f & Z80_CF) | sz53p_table[v];
+		break;
+	}
+	case 1: /* OUT (C),r */
+		io_write (cpu, bc, y == 6 ? 0 : get_r (cpu, y, USE_HL));
+		cpu->cpc_t += 4;
+		cpu->wz = bc + 1;
+		break;
+	case 2: /* SBC HL,rp / ADC HL,rp */
+		internal (cpu, 7);
+		if (q == 0)
+			set_hl (cpu, USE_HL, sbc16 (cpu, get_hl (cpu, USE_HL), get_rp (cpu, p, USE_HL)));
+		else
+			set_hl (cpu, USE_HL, adc16 (cpu, get_hl (cpu, USE_HL), get_rp (cpu, p, USE_HL)));
+		break;
+	case 3: /* LD (nn),rp / LD rp,(nn) */
+	{
+		uint16_t address = fetch16 (cpu);
+
+		if (q == 0)
+			write16 (cpu, address, get_rp (cpu, p, USE_HL));
+		else
+			set_rp (cpu, p, USE_HL, read16 (cpu, address));
+		cpu->wz = address + 1;
+		break;
+	}
+	case 4: /* NEG */
+	{
+		uint8_t v = cpu->a;
+
+		cpu->a = 0;
+		alu (cpu, 2, v);
+		break;
+	}
+	case 5: /* RETN / RETI */
+		cpu->iff1 = cpu->iff2;
+		cpu->pc = pop16 (cpu);
+		cpu->wz = cpu->pc;
+		break;
+	case 6: /* IM */
+	{
+		static const uint8_t modes[8] = { 0, 0, 1, 2, 0, 0, 1, 2 };
+
+		cpu->im = modes[y];
+		break;
+	}
+	default:
+		switch (y)
+		{
+		case 0: internal (cpu, 1); cpu->i = cpu->a; break;
+		case 1: internal (cpu, 1); cpu->r = cpu->a; break;
+		case 2:
+		case 3:
+			internal (cpu, 1);
+			cpu->a = y == 2 ? cpu->i : cpu->r;
+			cpu->f = (cpu->f & Z80_CF) | sz53_table[cpu->a] | (cpu->iff2 ? Z80_PF : 0);
+			break;
+		case 4: /* RRD */
+		case 5: /* RLD */
+		{
+			uint16_t hl = get_hl (cpu, USE_HL);
+			uint8_t v = read8 (cpu, hl);
+
+			internal (cpu, 4);
+			if (y == 4)
+			{
+				write8 (cpu, hl, (cpu->a << 4) | (v >> 4));
+				cpu->a = (cpu->a & 0xf0) | (v & 0x0f);
+			}
+			else
+			{
+				write8 (cpu, hl, (v << 4) | (cpu->a & 0x0f));
+				cpu->a = (cpu->a & 0xf0) | (v >> 4);
+			}
+			cpu->wz = hl + 1;
+			cpu->f = (cpu->f & Z80_CF) | sz53p_table[cpu->a];
+			break;
+		}
+		default:
+			break;
+		}
+		break;
+	}
+}
+
+/************************************************************************
+ * Unprefixed opcodes, possibly after DD or FD
+ ************************************************************************/
+
+static void
+execute (struct z80 *cpu, uint8_t op, int idx)
+{
+	int x = op >> 6, y = (op >> 3) & 7, z = op & 7, p = y >> 1, q = y & 1;
+
+	switch (x)
+	{
+	case 0:
+		switch (z)
+		{
+		case 0:
+			switch (y)
+			{
+			case 0: /* NOP */
+				break;
+			case 1: /* EX AF,AF' */
+			{
+				uint8_t a = cpu->a, f = cpu->f;
+
+				cpu->a = cpu->a_;
+				cpu->f = cpu->f_;
+				cpu->a_ = a;
+				cpu->f_ = f;
+				break;
+			}
+			case 2: /* DJNZ d */
+			{
+				int8_t d;
+
+				internal (cpu, 1);
+				d = fetch8 (cpu);
+				if (--cpu->b)
+				{
+					internal (cpu, 5);
+					cpu->pc += d;
+					cpu->wz = cpu->pc;
+				}
+				break;
+			}
+			default: /* JR d / JR cc,d */
+			{
+				int8_t d = fetch8 (cpu);
+
+				if (y == 3 || condition (cpu, y - 4))
+				{
+					internal (cpu, 5);
+					cpu->pc += d;
+					cpu->wz = cpu->pc;
+				}
+				break;
+			}
+			}
+			break;
+		case 1:
+			if (q == 0)
+				set_rp (cpu, p, idx, fetch16 (cpu));
+			else
+			{
+				internal (cpu, 7);
+				set_hl (cpu, idx, add16 (cpu, get_hl (cpu, idx), get_rp (cpu, p, idx)));
+			}
+			break;
+		case 2:
+		{
+			uint16_t address;
+
+			switch (p)
+			{
+			case 0:
+			case 1:
+				address = get_rp (cpu, p, USE_HL);
+				if (q == 0)
+				{
+					write8 (cpu, address, cpu->a);
+					cpu->wz = (cpu->a << 8) | ((address + 1) & 0xff);
+				}
+				else
+				{
+					cpu->a = read8 (cpu, address);
+					cpu->wz = address + 1;
+				}
+				break;
+			case 2:
+				address = fetch16 (cpu);
+				if (q == 0)
+					write16 (cpu, address, get_hl (cpu, idx));
+				else
+					set_hl (cpu, idx, read16 (cpu, address));
+				cpu->wz = address + 1;
+				break;
+			default:
+				address = fetch16 (cpu);
+				if (q == 0)
+				{
+					write8 (cpu, address, cpu->a);
+					cpu->wz = (cpu->a << 8) | ((address + 1) & 0xff);
+				}
+				else
+				{
+					cpu->a = read8 (cpu, address);
+					cpu->wz = address + 1;
+				}
+				break;
+			}
+			break;
+		}
+		case 3: /* INC rp / DEC rp */
+			internal (cpu, 2);
+			set_rp (cpu, p, idx, get_rp (cpu, p, idx) + (q ? -1 : 1));
+			break;
+		case 4: /* INC r */
+		case 5: /* DEC r */
+			if (y == 6)
+			{
+				uint16_t address = operand_address (cpu, idx, 5);
+				uint8_t v = read8 (cpu, address);
+
+				internal (cpu, 1);
+				write8 (cpu, address, z == 4 ? inc8 (cpu, v) : dec8 (cpu, v));
+			}
+			else
+			{
+				uint8_t v = get_r (cpu, y, idx);
+
+				set_r (cpu, y, idx, z == 4 ? inc8 (cpu, v) : dec8 (cpu, v));
+			}
+			break;
+		case 6: /* LD r,n */
+			if (y == 6)
+			{
+				uint16_t address = operand_address (cpu, idx, 0);
+				uint8_t n = fetch8 (cpu);
+
+				if (idx != USE_HL)
+					internal (cpu, 2);
+				write8 (cpu, address, n);
+			}
+			else
+				set_r (cpu, y, idx, fetch8 (cpu));
+			break;
+		default:
+			switch (y)
+			{
+			case 0: case 1: case 2: case 3: rot_a (cpu, y); break;
+			case 4: daa (cpu); break;
+			case 5: /* CPL */
+				cpu->a = ~cpu->a;
+				cpu->f = (cpu->f & (Z80_SF | Z80_ZF | Z80_PF | Z80_CF)) | Z80_HF | Z80_NF
+					| (cpu->a & (Z80_XF | Z80_YF));
+				break;
+			case 6: /* SCF */
+				cpu->f = (cpu->f & (Z80_SF | Z80_ZF | Z80_PF)) | Z80_CF
+					| (cpu->a & (Z80_XF | Z80_YF));
+				break;
+			default: /* CCF */
+				cpu->f = ((cpu->f & (Z80_SF | Z80_ZF | Z80_PF | Z80_CF))
+					  | ((cpu->f & Z80_CF) << 4) | (cpu->a & (Z80_XF | Z80_YF))) ^ Z80_CF;
+				break;
+			}
+			break;
+		}
+		break;
+
+	case 1:
+		if (y == 6 && z == 6)
+		{
+			/* HALT: repeat until an interrupt. */
+			cpu->halted = 1;
+			cpu->pc--;
+		}
+		else if (y == 6)
+		{
+			uint16_t address = operand_address (cpu, idx, 5);
+
+			write8 (cpu, address, get_r (cpu, z, USE_HL));
+		}
+		else if (z == 6)
+		{
+			uint16_t address = operand_address (cpu, idx, 5);
+
+			set_r (cpu, y, USE_HL, read8 (cpu, address));
+		}
+		else
+			set_r (cpu, y, idx, get_r (cpu, z, idx));
+		break;
+
+	case 2: /* ALU A,r */
+		if (z == 6)
+			alu (cpu, y, read8 (cpu, operand_address (cpu, idx, 5)));
+		else
+			alu (cpu, y, get_r (cpu, z, idx));
+		break;
+
+	default:
+		switch (z)
+		{
+		case 0: /* RET cc */
+			internal (cpu, 1);
+			if (condition (cpu, y))
+			{
+				cpu->pc = pop16 (cpu);
+				cpu->wz = cpu->pc;
+			}
+			break;
+		case 1:
+			if (q == 0)
+				set_rp2 (cpu, p, idx, pop16 (cpu));
+			else
+				switch (p)
+				{
+				case 0: /* RET */
+					cpu->pc = pop16 (cpu);
+					cpu->wz = cpu->pc;
+					break;
+				case 1: /* EXX */
+				{
+					uint8_t t;
+
+#define SWAP(r) t = cpu->r; cpu->r = cpu->r##_; cpu->r##_ = t
+					SWAP (b); SWAP (c); SWAP (d); SWAP (e); SWAP (h); SWAP (l);
+#undef SWAP
+					break;
+				}
+				case 2: /* JP (HL) */
+					cpu->pc = get_hl (cpu, idx);
+					break;
+				default: /* LD SP,HL */
+					internal (cpu, 2);
+					cpu->sp = get_hl (cpu, idx);
+					break;
+				}
+			break;
+		case 2: /* JP cc,nn */
+			cpu->wz = fetch16 (cpu);
+			if (condition (cpu, y))
+				cpu->pc = cpu->wz;
+			break;
+		case 3:
+			switch (y)
+			{
+			case 0: /* JP nn */
+				cpu->pc = cpu->wz = fetch16 (cpu);
+				break;
+			case 1:
+				execute_cb (cpu, idx);
+				break;
+			case 2: /* OUT (n),A */
+			{
+				uint8_t n = fetch8 (cpu);
+
+				io_write (cpu, (cpu->a << 8) | n, cpu->a);
+				cpu->wz = (cpu->a << 8) | ((n + 1) & 0xff);
+				break;
+			}
+			case 3: /* IN A,(n) */
+			{
+				uint16_t port = (cpu->a << 8) | fetch8 (cpu);
+
+				cpu->a = io_read (cpu, port);
+				cpu->wz = port + 1;
+				break;
+			}
+			case 4: /* EX (SP),HL */
+			{
+				uint16_t v = read16 (cpu, cpu->sp);
+
+				internal (cpu, 1);
+				write8 (cpu, cpu->sp + 1, get_hl (cpu, idx) >> 8);
+				write8 (cpu, cpu->sp, get_hl (cpu, idx) & 0xff);
+				internal (cpu, 2);
+				set_hl (cpu, idx, v);
+				cpu->wz = v;
+				break;
+			}
+			case 5: /* EX DE,HL */
+			{
+				uint8_t t = cpu->d;
+
+				cpu->d = cpu->h;
+				cpu->h = t;
+				t = cpu->e;
+				cpu->e = cpu->l;
+				cpu->l = t;
+				break;
+			}
+			case 6: /* DI */
+				cpu->iff1 = cpu->iff2 = 0;
+				break;
+			default: /* EI */
+				cpu->iff1 = cpu->iff2 = 1;
+				cpu->ei_pending = 1;
+				break;
+			}
+			break;
+		case 4: /* CALL cc,nn */
+			cpu->wz = fetch16 (cpu);
+			if (condition (cpu, y))
+			{
+				internal (cpu, 1);
+				push16 (cpu, cpu->pc);
+				cpu->pc = cpu->wz;
+			}
+			break;
+		case 5:
+			if (q == 0)
+			{
+				internal (cpu, 1);
+				push16 (cpu, get_rp2 (cpu, p, idx));
+			}
+			else
+				switch (p)
+				{
+				case 0: /* CALL nn */
+					cpu->wz = fetch16 (cpu);
+					internal (cpu, 1);
+					push16 (cpu, cpu->pc);
+					cpu->pc = cpu->wz;
+					break;
+				case 1: /* DD */
+					execute (cpu, fetch_opcode (cpu), USE_IX);
+					break;
+				case 2:
+					execute_ed (cpu);
+					break;
+				default: /* FD */
+					execute (cpu, fetch_opcode (cpu), USE_IY);
+					break;
+				}
+			break;
+		case 6: /* ALU A,n */
+			alu (cpu, y, fetch8 (cpu));
+			break;
+		default: /* RST */
+			internal (cpu, 1);
+			push16 (cpu, cpu->pc);
+			cpu->pc = cpu->wz = y * 8;
+			break;
+		}
+		break;
+	}
+}
+
+/************************************************************************
+ * Interface
+ ************************************************************************/
+
+void
+z80_init (struct z80 *cpu, uint8_t *memory64k)
+{
+	int i;
+
+	if (!tables_ready)
+		init_tables ();
+	memset (cpu, 0, sizeof (*cpu));
+	cpu->a = cpu->f = 0xff;
+	cpu->sp = 0xffff;
+	for (i = 0; i < Z80_PAGES; i++)
+		cpu->read_page[i] = cpu->write_page[i] = memory64k + i * Z80_PAGE_SIZE;
+}
+
+void
+z80_step (struct z80 *cpu)
+{
+	cpu->ei_pending = 0;
+	if (cpu->halted)
+	{
+		/* HALT executes NOPs. */
+		cpc_align (cpu);
+		internal (cpu, 4);
+		cpu->r = (cpu->r & 0x80) | ((cpu->r + 1) & 0x7f);
+	}
+	else
+		execute (cpu, fetch_opcode (cpu), USE_HL);
+	cpc_align (cpu);
+	cpu->instructions++;
+}
+
+int
+z80_irq (struct z80 *cpu, uint8_t data)
+{
+	if (!cpu->iff1 || cpu->ei_pending)
+		return 0;
+	if (cpu->halted)
+	{
+		cpu->halted = 0;
+		cpu->pc++;
+	}
+	cpu->iff1 = cpu->iff2 = 0;
+	cpu->r = (cpu->r & 0x80) | ((cpu->r + 1) & 0x7f);
+	/* Acknowledge cycle: 7 T-states (IM 1), then the pushes. */
+	cpc_align (cpu);
+	internal (cpu, 7);
+	push16 (cpu, cpu->pc);
+	if (cpu->im == 2)
+		cpu->pc = read16 (cpu, (cpu->i << 8) | data);
+	else
+		cpu->pc = 0x38;
+	cpu->wz = cpu->pc;
+	cpc_align (cpu);
+	return 1;
+}
+
+unsigned int
+z80_instruction_length (const struct z80 *cpu, uint16_t address)
+{
+	uint8_t op = z80_peek (cpu, address);
+	int x = op >> 6, z = op & 7, y = (op >> 3) & 7, p = y >> 1, q = y & 1;
+	unsigned int prefix = 0;
+
+	if (op == 0xdd || op == 0xfd)
+	{
+		op = z80_peek (cpu, address + 1);
+		if (op == 0xdd || op == 0xfd || op == 0xed)
+			return 1;
+		if (op == 0xcb)
+			return 4;
+		prefix = 1;
+		x = op >> 6;
+		z = op & 7;
+		y = (op >> 3) & 7;
+		p = y >> 1;
+		q = y & 1;
+		/* (IX+d) takes one more byte. */
+		if ((x == 0 && (z == 4 || z == 5 || z == 6) && y == 6)
+		    || (x == 1 && (y == 6 || z == 6) && !(y == 6 && z == 6))
+		    || (x == 2 && z == 6))
+			prefix = 2;
+	}
+	if (op == 0xcb)
+		return 2;
+	if (op == 0xed)
+	{
+		op = z80_peek (cpu, address + 1);
+		return ((op & 0xc7) == 0x43) ? 4 : 2;
+	}
+	switch (x)
+	{
+	case 0:
+		if (z == 0)
+			return prefix + (y >= 2 ? 2 : 1);
+		if (z == 1)
+			return prefix + (q ? 1 : 3);
+		if (z == 2)
+			return prefix + (p >= 2 ? 3 : 1);
+		if (z == 6)
+			return prefix + 2;
+		return prefix + 1;
+	case 3:
+		if (z == 2 || z == 4 || (z == 3 && y == 0) || (z == 5 && q && p == 0))
+			return prefix + 3;
+		if (z == 6 || (z == 3 && (y == 2 || y == 3)))
+			return prefix + 2;
+		return prefix + 1;
+	default:
+		return prefix + 1;
+	}
+}
@@ -0,0 +1,71 @@
+/*
+ * Z80 core for cdtc_sim and other host tools of cpc-dev-tool-chain.
+ *
+ * Every instruction is broken down into the machine cycles the real
+ * CPU performs (opcode fetch, memory read or write, I/O, internal
+ * cycles).  This gives exact Z80 T-states, and an estimate of CPC
+ * timing: on the CPC the gate array stretches every memory and I/O
+ * access so that it starts on a 4 T-state boundary, hence the usual
+ * count of "NOPs" (1 NOP = 4 T-states = 1 microsecond).
+ */
+
+#ifndef CDTC_Z80_H
+#define CDTC_Z80_H
+
+#include <stdint.h>
+
+#define Z80_PAGE_SIZE 0x4000
+#define Z80_PAGES 4
+
+struct z80
+{
+	uint8_t a, f, b, c, d, e, h, l;
+	uint8_t a_, f_, b_, c_, d_, e_, h_, l_;
+	uint16_t ix, iy, sp, pc;
+	uint16_t wz;		/* internal register, shows in some flags */
+	uint8_t i, r, im, iff1, iff2;
+	uint8_t halted;
+	uint8_t ei_pending;	/* no interrupt right after EI */
+
+	uint64_t t;		/* Z80 T-states */
+	uint64_t cpc_t;		/* T-states with CPC wait states */
+	uint64_t instructions;
+
+	/* 64K seen by the CPU as four 16K pages, so that the host can
+	   map banks like the CPC gate array does. */
+	uint8_t *read_page[Z80_PAGES];
+	uint8_t *write_page[Z80_PAGES];
+
+	uint8_t (*in) (void *ctx, uint16_t port);
+	void (*out) (void *ctx, uint16_t port, uint8_t value);
+	void *ctx;
+};
+
+/* Flag bits. */
+#define Z80_CF 0x01
+#define Z80_NF 0x02
+#define Z80_PF 0x04
+#define Z80_XF 0x08
+#define Z80_HF 0x10
+#define Z80_YF 0x20
+#define Z80_ZF 0x40
+#define Z80_SF 0x80
+
+/* Power-on state, all pages mapped to one flat 64K array. */
+void z80_init (struct z80 *cpu, uint8_t *memory64k);
+
+/* Execute one instruction (or one HALT cycle). */
+void z80_step (struct z80 *cpu);
+
+/* Maskable interrupt request, data is what the device puts on the bus
+   (used in IM 2).  Returns non-zero if the CPU accepted it. */
+int z80_irq (struct z80 *cpu, uint8_t data);
+
+/* Memory access from the host, without timing. */
+uint8_t z80_peek (const struct z80 *cpu, uint16_t address);
+void z80_poke (struct z80 *cpu, uint16_t address, uint8_t value);
+
+/* Length in bytes of the instruction at address. */
+unsigned int z80_instruction_length (const struct z80 *cpu, uint16_t address);
+
+#endif /* CDTC_Z80_H */
@@ -0,0 +1,853 @@
+/*
+ * cdtc_table: generate lookup tables at build time.
+ *
+ * Reads a table spec, foo.tables, with one table per line:
+ *
+ *   NAME TYPE[COUNT] [align=N] = EXPRESSION
+ *
+ * for example
+ *
+ *   squares_div4 u16[512] align=256 = i * i / 4
+ *   sine s8[256] align=256 = round (127 * sin (2 * pi * i / n))
+ *   screen_lines u16[200] = 0xC000 + i / 8 * 80 + i % 8 * 0x800
+ *   pixel_masks u8[4] = 0x88 >> i
+ *
+ * TYPE is u8, s8, u16 or s16.  EXPRESSION gives the element of index i
+ * (0 to n - 1, n being COUNT).  It is a C expression: integers unless a
+ * floating point number, pi, sin, cos, tan, atan, sqrt or exp is
+ * involved; a floating point value is truncated as C does, round, floor
+ * and ceil give integers.  A value that does not fit the type is an
+ * error.  With align=N the table starts at an address multiple of N
+ * (a power of two): with align=256 the high byte of the address is the
+ * same for all elements of a byte table of up to 256 elements.  "#"
+ * starts a comment.
+ *
+ *   cdtc_table foo.tables foo.tables.asm foo.tables.h
+ *
+ * writes the tables in an sdasz80 source, each under the global symbol
+ * _NAME, and a C header declaring them as const arrays.  Tables with
+ * align=256 go to area _ALIGNED256, the others to _CODE.
+ * Either output may be "-" to not write it.  The header is rewritten
+ * only when its content changes, so that C files that include it are
+ * not recompiled when only values change.
+ *
+ *   cdtc_table --check foo.map foo.tables...
+ *
+ * checks that each aligned table of the specs is aligned in the linked
+ * program.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LINE 4096
+
+static const char *progname = "cdtc_table";
+
+static void
+die (const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start (ap, fmt);
+	fprintf (stderr, "%s: ", progname);
+	vfprintf (stderr, fmt, ap);
+	fputc ('\n', stderr);
+	va_end (ap);
+	exit (1);
+}
+
+static void *
+xmalloc (size_t size)
+{
+	void *p = malloc (size);
+
+	if (p == NULL)
+		die ("out of memory");
+	return p;
+}
+
+static char *
+xstrndup (const char *s, size_t length)
+{
+	char *p = xmalloc (length + 1);
+
+	memcpy (p, s, length);
+	p[length] = '\0';
+	return p;
+}
+
+/************************************************************************
+ * Output text
+ ************************************************************************/
+
+struct text
+{
+	char *data;
+	size_t length, allocated;
+};
+
+static void
+text_printf (struct text *t, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	for (;;)
+	{
+		va_start (ap, fmt);
+		n = vsnprintf (t->data + t->length, t->allocated - t->length,
+			       fmt, ap);
+		va_end (ap);
+		if (n < 0)
+			die ("cannot format output");
+		if (t->length + n < t->allocated)
+			break;
+		t->allocated = (t->length + n + 1) * 2;
+		t->data = realloc (t->data, t->allocated);
+		if (t->data == NULL)
+			die ("out of memory");
+	}
+	t->length += n;
+}
+
+/* Keep the old file, and its time, when the content is the same. */
+static void
+write_if_changed (const char *filename, const struct text *t)
+{
+	FILE *f = fopen (filename, "rb");
+	char *tmpname;
+
+	if (f != NULL)
+	{
+		char *old = xmalloc (t->length + 1);
+		size_t got = fread (old, 1, t->length + 1, f);
+		int same = got == t->length && memcmp (old, t->data, got) == 0;
+
+		fclose (f);
+		free (old);
+		if (same)
+			return;
+	}
+
+	tmpname = xmalloc (strlen (filename) + 5);
+	sprintf (tmpname, "%s.tmp", filename);
+	f = fopen (tmpname, "wb");
+	if (f == NULL)
+		die ("%s: %s", tmpname, strerror (errno));
+	if (fwrite (t->data, 1, t->length, f) != t->length || fclose (f) != 0)
+		die ("%s: %s", tmpname, strerror (errno));
+	if (rename (tmpname, filename) != 0)
+		die ("%s: %s", filename, strerror (errno));
+	free (tmpname);
+}
+
+/************************************************************************
+ * Expressions
+ ************************************************************************/
+
+struct value
+{
+	int is_float;
+	long long i;
+	double f;
+};
+
+/* Where an expression is parsed, and for which element. */
+struct parser
+{
+	const char *p;
+	const char *filename;
+	unsigned int lineno;
+	long long index, count;
+};
+
+static void
+parse_error (const struct parser *ps, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start (ap, fmt);
+	fprintf (stderr, "%s: %s:%u: ", progname, ps->filename, ps->lineno);
+	vfprintf (stderr, fmt, ap);
+	fputc ('\n', stderr);
+	va_end (ap);
+	exit (1);
+}
+
+static struct value
+integer (long long i)
+{
+	struct value v = { 0, i, (double) i };
+
+	return v;
+}
+
+static struct value
+real (double f)
+{
+	struct value v = { 1, (long long) f, f };
+
+	return v;
+}
+
+static void
+skip_blanks (struct parser *ps)
+{
+	while (*ps->p == ' ' || *ps->p == '\t')
+		ps->p++;
+}
+
+/* Consume OP if it comes next, but not the start of a longer operator. */
+static int
+accept (struct parser *ps, const char *op)
+{
+	size_t length = strlen (op);
+
+	skip_blanks (ps);
+	if (strncmp (ps->p, op, length) != 0)
+		return 0;
+	if (length == 1 && (op[0] == '<' || op[0] == '>') && ps->p[1] == op[0])
+		return 0;
+	ps->p += length;
+	return 1;
+}
+
+static long long
+need_integer (const struct parser *ps, struct value v, const char *op)
+{
+	if (v.is_float)
+		parse_error (ps, "%s needs integers, use round(), floor() or ceil()", op);
+	return v.i;
+}
+
+static struct value parse_or (struct parser *ps);
+
+static struct value
+call_function (struct parser *ps, const char *name, size_t length,
+	       struct value arg)
+{
+	static const struct
+	{
+		const char *name;
+		double (*function) (double);
+		int gives_integer;
+	} functions[] = {
+		{"sin", sin, 0}, {"cos", cos, 0}, {"tan", tan, 0},
+		{"atan", atan, 0}, {"sqrt", sqrt, 0}, {"exp", exp, 0},
+		{"round", round, 1}, {"floor", floor, 1}, {"ceil", ceil, 1},
+	};
+	unsigned int i;
+
+	if (length == 3 && strncmp (name, "abs", 3) == 0)
+		return arg.is_float ? real (fabs (arg.f)) : integer (llabs (arg.i));
+	for (i = 0; i < sizeof functions / sizeof functions[0]; i++)
+		if (strlen (functions[i].name) == length
+		    && strncmp (functions[i].name, name, length) == 0)
+		{
+			double f = functions[i].function (arg.f);
+
+			return functions[i].gives_integer ? integer ((long long) f) : real (f);
+		}
+	parse_error (ps, "unknown function %.*s", (int) length, name);
+	return arg;
+}
+
+static struct value
+parse_primary (struct parser *ps)
+{
+	skip_blanks (ps);
+	if (accept (ps, "("))
+	{
+		struct value v = parse_or (ps);
+
+		if (!accept (ps, ")"))
+			parse_error (ps, "missing )");
+		return v;
+	}
+	if (isdigit ((unsigned char) *ps->p) || *ps->p == '.' || *ps->p == '&')
+	{
+		const char *start = ps->p;
+		char *end;
+
+		if (*start == '&')
+			return integer (strtoll (start + 1, (char **) &ps->p, 16));
+		if (start[0] == '0' && (start[1] == 'x' || start[1] == 'X'))
+			return integer (strtoll (start, (char **) &ps->p, 16));
+		strtoll (start, &end, 10);
+		if (*end == '.' || *end == 'e' || *end == 'E')
+			return real (strtod (start, (char **) &ps->p));
+		return integer (strtoll (start, (char **) &ps->p, 10));
+	}
+	if (isalpha ((unsigned char) *ps->p) || *ps->p == '_')
+	{
+		const char *name = ps->p;
+		size_t length;
+
+		while (isalnum ((unsigned char) *ps->p) || *ps->p == '_')
+			ps->p++;
+		length = ps->p - name;
+		if (accept (ps, "("))
+		{
+			struct value arg = parse_or (ps);
+
+			if (!accept (ps, ")"))
+				parse_error (ps, "missing ) after argument of %.*s",
+					     (int) length, name);
+			return call_function (ps, name, length, arg);
+		}
+		if (length == 1 && *name == 'i')
+			return integer (ps->index);
+		if (length == 1 && *name == 'n')
+			return integer (ps->count);
+		if (length == 2 && strncmp (name, "pi", 2) == 0)
+			return real (M_PI);
+		parse_error (ps, "unknown name %.*s, expected i, n or pi",
+			     (int) length, name);
+	}
+	parse_error (ps, "expected a value at \"%s\"", ps->p);
+	return integer (0);
+}
+
+static struct value
+parse_unary (struct parser *ps)
+{
+	struct value v;
+
+	if (accept (ps, "-"))
+	{
+		v = parse_unary (ps);
+		return v.is_float ? real (-v.f) : integer (-v.i);
+	}
+	if (accept (ps, "+"))
+		return parse_unary (ps);
+	if (accept (ps, "~"))
+	{
+		v = parse_unary (ps);
+		return integer (~need_integer (ps, v, "~"));
+	}
+	return parse_primary (ps);
+}
+
+static struct value
+parse_multiplicative (struct parser *ps)
+{
+	struct value a = parse_unary (ps), b;
+
+	for (;;)
+	{
+		if (accept (ps, "*"))
+		{
+			b = parse_unary (ps);
+			a = a.is_float || b.is_float ? real (a.f * b.f) : integer (a.i * b.i);
+		}
+		else if (accept (ps, "/"))
+		{
+			b = parse_unary (ps);
+			if (a.is_float || b.is_float)
+				a = real (a.f / b.f);
+			else if (b.i == 0)
+				parse_error (ps, "division by zero for i = %lld", ps->index);
+			else
+				a = integer (a.i / b.i);
+		}
+		else if (accept (ps, "%"))
+		{
+			b = parse_unary (ps);
+			if (need_integer (ps, b, "%") == 0)
+				parse_error (ps, "division by zero for i = %lld", ps->index);
+			a = integer (need_integer (ps, a, "%") % b.i);
+		}
+		else
+			return a;
+	}
+}
+
+static struct value
+parse_additive (struct parser *ps)
+{
+	struct value a = parse_multiplicative (ps), b;
+
+	for (;;)
+	{
+		if (accept (ps, "+"))
+		{
+			b = parse_multiplicative (ps);
+			a = a.is_float || b.is_float ? real (a.f + b.f) : integer (a.i + b.i);
+		}
+		else if (accept (ps, "-"))
+		{
+			b = parse_multiplicative (ps);
+			a = a.is_float || b.is_float ? real (a.f - b.f) : integer (a.i - b.i);
+		}
+		else
+			return a;
+	}
+}
+
+static struct value
+parse_shift (struct parser *ps)
+{
+	struct value a = parse_additive (ps), b;
+
+	for (;;)
+	{
+		if (accept (ps, "<<"))
+		{
+			b = parse_additive (ps);
+			a = integer (need_integer (ps, a, "<<") << need_integer (ps, b, "<<"));
+		}
+		else if (accept (ps, ">>"))
+		{
+			b = parse_additive (ps);
+			a = integer (need_integer (ps, a, ">>") >> need_integer (ps, b, ">>"));
+		}
+		else
+			return a;
+	}
+}
+
+static struct value
+parse_and (struct parser *ps)
+{
+	struct value a = parse_shift (ps), b;
+
+	while (accept (ps, "&"))
+	{
+		b = parse_shift (ps);
+		a = integer (need_integer (ps, a, "&") & need_integer (ps, b, "&"));
+	}
+	return a;
+}
+
+static struct value
+parse_xor (struct parser *ps)
+{
+	struct value a = parse_and (ps), b;
+
+	while (accept (ps, "^"))
+	{
+		b = parse_and (ps);
+		a = integer (need_integer (ps, a, "^") ^ need_integer (ps, b, "^"));
+	}
+	return a;
+}
+
+static struct value
+parse_or (struct parser *ps)
+{
+	struct value a = parse_xor (ps), b;
+
+	while (accept (ps, "|"))
+	{
+		b = parse_xor (ps);
+		a = integer (need_integer (ps, a, "|") | need_integer (ps, b, "|"));
+	}
+	return a;
+}
+
+/************************************************************************
+ * Table specs
+ ************************************************************************/
+
+struct table
+{
+	char *name;
+	const char *type;	/* u8 s8 u16 s16 */
+	const char *c_type;
+	long long count;
+	unsigned long align;
+	char *expression;
+	unsigned int lineno;
+};
+
+struct spec
+{
+	const char *filename;
+	struct table *tables;
+	unsigned int count, allocated;
+};
+
+static const struct
+{
+	const char *name, *c_type;
+	unsigned int bytes;
+	long long min, max;
+} types[] = {
+	{"u8", "uint8_t", 1, 0, 0xFF},
+	{"s8", "int8_t", 1, -0x80, 0x7F},
+	{"u16", "uint16_t", 2, 0, 0xFFFF},
+	{"s16", "int16_t", 2, -0x8000, 0x7FFF},
+};
+
+static unsigned int
+type_index (const char *type)
+{
+	unsigned int i;
+
+	for (i = 0; i < sizeof types / sizeof types[0]; i++)
+		if (strcmp (types[i].name, type) == 0)
+			return i;
+	return 0;
+}
+
+static const char *
+skip_spaces (const char *p)
+{
+	while (*p == ' ' || *p == '\t')
+		p++;
+	return p;
+}
+
+/* "NAME TYPE[COUNT] [align=N] = EXPRESSION" */
+static void
+parse_spec_line (struct spec *s, char *line, unsigned int lineno)
+{
+	struct parser ps = { line, s->filename, lineno, 0, 0 };
+	struct table t;
+	const char *p = skip_spaces (line), *start;
+	char *end;
+	unsigned int i;
+
+	memset (&t, 0, sizeof t);
+	t.lineno = lineno;
+	t.align = 1;
+
+	start = p;
+	while (isalnum ((unsigned char) *p) || *p == '_')
+		p++;
+	if (p == start || isdigit ((unsigned char) *start))
+		parse_error (&ps, "expected a table name");
+	t.name = xstrndup (start, p - start);
+
+	p = skip_spaces (p);
+	start = p;
+	while (isalnum ((unsigned char) *p))
+		p++;
+	for (i = 0; i < sizeof types / sizeof types[0]; i++)
+		if (strlen (types[i].name) == (size_t) (p - start)
+		    && strncmp (types[i].name, start, p - start) == 0)
+			break;
+	if (i == sizeof types / sizeof types[0])
+		parse_error (&ps, "%s: expected a type: u8, s8, u16 or s16", t.name);
+	t.type = types[i].name;
+	t.c_type = types[i].c_type;
+	if (*p != '[')
+		parse_error (&ps, "%s: expected [COUNT] after the type", t.name);
+	t.count = strtoll (p + 1, &end, 0);
+	if (*end != ']' || t.count <= 0 || t.count * types[i].bytes > 0x10000)
+		parse_error (&ps, "%s: bad element count", t.name);
+	p = skip_spaces (end + 1);
+
+	while (*p != '=')
+	{
+		if (strncmp (p, "align=", 6) != 0)
+			parse_error (&ps, "%s: expected align=N or = EXPRESSION", t.name);
+		t.align = strtoul (p + 6, &end, 0);
+		if (end == p + 6 || t.align == 0 || (t.align & (t.align - 1)) != 0
+		    || t.align > 0x4000)
+			parse_error (&ps, "%s: align must be a power of two up to &4000", t.name);
+		p = skip_spaces (end);
+	}
+	p = skip_spaces (p + 1);
+	if (*p == '\0')
+		parse_error (&ps, "%s: missing expression", t.name);
+	t.expression = xstrndup (p, strlen (p));
+
+	for (i = 0; i < s->count; i++)
+		if (strcmp (s->tables[i].name, t.name) == 0)
+			parse_error (&ps, "%s: already defined at line %u", t.name,
+				     s->tables[i].lineno);
+	if (s->count == s->allocated)
+	{
+		s->allocated = s->allocated ? 2 * s->allocated : 16;
+		s->tables = realloc (s->tables, s->allocated * sizeof *s->tables);
+		if (s->tables == NULL)
+			die ("out of memory");
+	}
+	s->tables[s->count++] = t;
+}
+
+static void
+read_spec (const char *filename, struct spec *s)
+{
+	FILE *f = fopen (filename, "r");
+	char line[MAX_LINE];
+	unsigned int lineno = 0;
+
+	if (f == NULL)
+		die ("%s: %s", filename, strerror (errno));
+	memset (s, 0, sizeof *s);
+	s->filename = filename;
+	while (fgets (line, sizeof line, f) != NULL)
+	{
+		char *comment = strchr (line, '#');
+		size_t length;
+
+		lineno++;
+		if (comment != NULL)
+			*comment = '\0';
+		length = strlen (line);
+		while (length > 0 && isspace ((unsigned char) line[length - 1]))
+			line[--length] = '\0';
+		if (*skip_spaces (line) != '\0')
+			parse_spec_line (s, line, lineno);
+	}
+	if (ferror (f))
+		die ("%s: %s", filename, strerror (errno));
+	fclose (f);
+}
+
+/************************************************************************
+ * Output
+ ************************************************************************/
+
+static long long
+element (const struct spec *s, const struct table *t, long long index)
+{
+	struct parser ps = { t->expression, s->filename, t->lineno, index, t->count };
+	const unsigned int type = type_index (t->type);
+	struct value v = parse_or (&ps);
+
+	skip_blanks (&ps);
+	if (*ps.p != '\0')
+		parse_error (&ps, "%s: unexpected \"%s\"", t->name, ps.p);
+	if (v.is_float)
+		v = integer ((long long) v.f);
+	if (v.i < types[type].min || v.i > types[type].max)
+		parse_error (&ps, "%s: element %lld is %lld, out of range for %s",
+			     t->name, index, v.i, t->type);
+	return v.i;
+}
+
+static void
+put_table (struct text *t, const struct spec *s, const struct table *table)
+{
+	const unsigned int bytes = types[type_index (table->type)].bytes;
+	const unsigned int per_line = bytes == 1 ? 16 : 8;
+	long long index;
+
+	text_printf (t, "\n");
+	if (table->align > 1 && table->align != 256)
+		text_printf (t, "\t.bndry %lu\n", table->align);
+	text_printf (t, "_%s::\n", table->name);
+	for (index = 0; index < table->count; index++)
+	{
+		unsigned long value = (unsigned long) element (s, table, index)
+			& (bytes == 1 ? 0xFF : 0xFFFF);
+
+		if (index % per_line == 0)
+			text_printf (t, bytes == 1 ? "\t.db\t" : "\t.dw\t");
+		text_printf (t, bytes == 1 ? "0x%02lX" : "0x%04lX", value);
+		text_printf (t, index % per_line == per_line - 1
+			     || index == table->count - 1 ? "\n" : ", ");
+	}
+}
+
+/* Bytes after a table up to the next multiple of 256. */
+static unsigned int
+padding (const struct table *table)
+{
+	return -(table->count * types[type_index (table->type)].bytes) & 0xFF;
+}
+
+/* Tables with align=256 go to area _ALIGNED256, which the link starts
+   on a multiple of 256 (see tool/cdtc_align), each padded to the next
+   multiple of 256 but the one that would need the most padding, which
+   goes last.  Other tables go to _CODE. */
+static void
+put_asm (struct text *t, const struct spec *s, const char *module)
+{
+	const struct table *last = NULL;
+	unsigned int i;
+
+	text_printf (t,
+		     ";; Generated by cdtc_table from %s, DO NOT EDIT.\n"
+		     "\t.module %s\n"
+		     "\n"
+		     "\t.area _CODE\n",
+		     s->filename, module);
+	for (i = 0; i < s->count; i++)
+	{
+		const struct table *table = &s->tables[i];
+
+		if (table->align != 256)
+			put_table (t, s, table);
+		else if (last == NULL || padding (table) > padding (last))
+			last = table;
+	}
+	if (last == NULL)
+		return;
+	text_printf (t, "\n\t.area _ALIGNED256\n");
+	for (i = 0; i < s->count; i++)
+	{
+		const struct table *table = &s->tables[i];
+
+		if (table->align != 256 || table == last)
+			continue;
+		put_table (t, s, table);
+		if (padding (table) > 0)
+			text_printf (t, "\t.ds\t%u\n", padding (table));
+	}
+	put_table (t, s, last);
+}
+
+static void
+put_header (struct text *t, const struct spec *s, const char *guard)
+{
+	unsigned int i;
+
+	text_printf (t,
+		     "/* Generated by cdtc_table from %s, DO NOT EDIT. */\n"
+		     "#ifndef %s\n"
+		     "#define %s\n"
+		     "\n"
+		     "#include <stdint.h>\n"
+		     "\n",
+		     s->filename, guard, guard);
+	for (i = 0; i < s->count; i++)
+	{
+		const struct table *table = &s->tables[i];
+
+		if (table->align > 1)
+			text_printf (t, "/* Aligned on %lu bytes. */\n", table->align);
+		text_printf (t, "extern const %s %s[%lld];\n",
+			     table->c_type, table->name, table->count);
+	}
+	text_printf (t, "\n#endif /* %s */\n", guard);
+}
+
+/* The file name without directory, as an identifier. */
+static char *
+identifier (const char *filename, int upper)
+{
+	const char *base = strrchr (filename, '/');
+	char *id, *p;
+
+	id = xstrndup (base ? base + 1 : filename, strlen (base ? base + 1 : filename));
+	for (p = id; *p != '\0'; p++)
+		*p = isalnum ((unsigned char) *p) ? (upper ? toupper ((unsigned char) *p) : *p) : '_';
+	return id;
+}
+
+/************************************************************************
+ * Checking alignment in the linked program
+ ************************************************************************/
+
+/* Address of global symbol NAME in a map file, -1 if not found. */
+static long
+map_address (const char *filename, const char *name)
+{
+	FILE *f = fopen (filename, "r");
+	char line[MAX_LINE];
+	long address = -1;
+
+	if (f == NULL)
+		die ("%s: %s", filename, strerror (errno));
+	while (address < 0 && fgets (line, sizeof line, f) != NULL)
+	{
+		char value[MAX_LINE], symbol[MAX_LINE];
+
+		if (sscanf (line, " %s %s", value, symbol) == 2
+		    && strcmp (symbol, name) == 0
+		    && strspn (value, "0123456789ABCDEFabcdef") == strlen (value))
+			address = strtol (value, NULL, 16);
+	}
+	fclose (f);
+	return address;
+}
+
+static int
+check_alignment (const char *map, char **specs, int count)
+{
+	int i, bad = 0;
+
+	for (i = 0; i < count; i++)
+	{
+		struct spec s;
+		unsigned int j;
+
+		read_spec (specs[i], &s);
+		for (j = 0; j < s.count; j++)
+		{
+			const struct table *t = &s.tables[j];
+			char *symbol;
+			long address;
+
+			if (t->align <= 1)
+				continue;
+			symbol = xmalloc (strlen (t->name) + 2);
+			sprintf (symbol, "_%s", t->name);
+			address = map_address (map, symbol);
+			if (address >= 0 && address % t->align != 0)
+			{
+				fprintf (stderr, "%s: %s:%u: %s is at &%04lX, not aligned on %lu bytes\n",
+					 progname, specs[i], t->lineno, t->name,
+					 (unsigned long) address, t->align);
+				bad = 1;
+			}
+			free (symbol);
+		}
+	}
+	return bad;
+}
+
+static void
+usage (FILE *f)
+{
+	fprintf (f,
+		 "Usage: %s foo.tables output.asm|- output.h|-\n"
+		 "       %s --check program.map foo.tables...\n"
+		 "  -c, --check MAP  check the alignment of tables in a linked program\n"
+		 "  -h, --help\n",
+		 progname, progname);
+}
+
+int
+main (int argc, char **argv)
+{
+	static const struct option options[] = {
+		{"check", required_argument, NULL, 'c'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0}
+	};
+	int opt;
+	const char *map = NULL;
+	struct spec s;
+	struct text asm_text = { NULL, 0, 0 }, header = { NULL, 0, 0 };
+	char *module, *guard;
+
+	while ((opt = getopt_long (argc, argv, "c:h", options, NULL)) != -1)
+	{
+		switch (opt)
+		{
+		case 'c': map = optarg; break;
+		case 'h': usage (stdout); return 0;
+		default: usage (stderr); return 1;
+		}
+	}
+	if (map != NULL)
+		return check_alignment (map, argv + optind, argc - optind);
+	if (optind != argc - 3)
+	{
+		usage (stderr);
+		return 1;
+	}
+
+	read_spec (argv[optind], &s);
+	module = identifier (argv[optind], 0);
+	guard = identifier (argv[optind + 2], 1);
+	put_asm (&asm_text, &s, module);
+	put_header (&header, &s, guard);
+	if (strcmp (argv[optind + 1], "-") != 0)
+		write_if_changed (argv[optind + 1], &asm_text);
+	if (strcmp (argv[optind + 2], "-") != 0)
+		write_if_changed (argv[optind + 2], &header);
+	return 0;
+}
@@ -0,0 +1,193 @@
+#!/bin/bash
+
+# Local store of source archives and built tool trees, so that a fresh
+# checkout or worktree gets its tools in seconds, without network.
+#
+# Usage:
+#   cdtc_toolstore.sh key PRODUCT URL [FILE...]
+#                                print the key of a tool build
+#   cdtc_toolstore.sh has KEY    succeed if a build is stored under KEY
+#   cdtc_toolstore.sh save KEY PATH...
+#                                store PATHs (relative to the current
+#                                directory) under KEY
+#   cdtc_toolstore.sh restore KEY
+#                                extract what was stored under KEY into the
+#                                current directory
+#   cdtc_toolstore.sh fetch URL OUTPUT [LOG]
+#                                copy the archive at URL from the store to
+#                                OUTPUT, or download it with wget and
+#                                store it.  LOG receives the wget log.
+#   cdtc_toolstore.sh --list     list stored sources and builds
+#   cdtc_toolstore.sh --export FILE.tar
+#   cdtc_toolstore.sh --import FILE.tar
+#                                carry the whole store to another machine
+#
+# The key of a build covers the product name, its URL (which names the
+# version), the content of each FILE (the tool makefiles, build scripts
+# and *_build_patch.patch), the machine type and the host C compiler
+# version.  Built trees hold machine code, and some of them (SDCC) find
+# their own files relative to their binaries, so restoring them in any
+# directory of the same machine type is fine.
+#
+# Environment:
+#   CDTC_TOOLSTORE_DIR      where the store lives, default
+#                           ~/.cache/cpc-dev-tool-chain/toolstore so that all
+#                           checkouts share it.  A directory on a shared
+#                           drive works as a mirror for a team.
+#   CDTC_TOOLSTORE_OFFLINE  if non-empty, never download: a source archive
+#                           missing from the store is an error
+
+set -eu -o pipefail
+
+STOREDIR="${CDTC_TOOLSTORE_DIR:-${XDG_CACHE_HOME:-${HOME}/.cache}/cpc-dev-tool-chain/toolstore}"
+
+function usage()
+{
+    echo >&2 "Usage: $0 key PRODUCT URL [FILE...] | has KEY | save KEY PATH... | restore KEY | fetch URL OUTPUT [LOG] | --list | --export FILE.tar | --import FILE.tar"
+    exit 2
+}
+
+function compute_key()
+{
+    local PRODUCT="$1" URL="$2" FILE
+    shift 2
+    {
+        echo "cdtc_toolstore 1"
+        echo "$PRODUCT"
+        echo "$URL"
+        uname -sm
+        ${CC:-cc} --version 2>/dev/null | head -n 1 || true
+        for FILE in "$@"
+        do
+            echo "== ${FILE}"
+            cat "$FILE"
+        done
+    } | sha1sum | cut -c 1-40
+}
+
+function source_entry()
+{
+    echo "${STOREDIR}/sources/$( echo "$1" | sha1sum | cut -c 1-40 )"
+}
+
+function fetch()
+{
+    local URL="$1" OUTPUT="$2" LOG="${3:-}" ENTRY NEWENTRY
+    ENTRY="$( source_entry "$URL" )"
+
+    if [[ -r "${ENTRY}/data" ]]
+    then
+        echo "cdtc_toolstore: ${URL} from ${ENTRY}"
+        cp -f "${ENTRY}/data" "$OUTPUT"
+        if [[ -n "$LOG" ]]
+        then cp -f "${ENTRY}/log" "$LOG"
+        fi
+        return 0
+    fi
+
+    if [[ -n "${CDTC_TOOLSTORE_OFFLINE:-}" ]]
+    then
+        echo >&2 "cdtc_toolstore: ${URL} is not in ${STOREDIR} and CDTC_TOOLSTORE_OFFLINE is set."
+        return 1
+    fi
+
+    if [[ -n "$LOG" ]]
+    then wget -c -S "$URL" -O "$OUTPUT" -o "$LOG"
+    else wget -S "$URL" -O "$OUTPUT"
+    fi
+
+    mkdir -p "${STOREDIR}/sources"
+    NEWENTRY="$( mktemp -d "${ENTRY}.XXXXXX" )"
+    cp -f "$OUTPUT" "${NEWENTRY}/data"
+    if [[ -n "$LOG" ]]
+    then cp -f "$LOG" "${NEWENTRY}/log"
+    else touch "${NEWENTRY}/log"
+    fi
+    echo "$URL" >"${NEWENTRY}/url"
+    if [[ -e "$ENTRY" ]] || ! mv "$NEWENTRY" "$ENTRY" 2>/dev/null
+    then rm -rf "$NEWENTRY"
+    fi
+}
+
+function save()
+{
+    local KEY="$1" TMP
+    shift
+    mkdir -p "${STOREDIR}/builds"
+    TMP="$( mktemp "${STOREDIR}/builds/${KEY}.tar.gz.XXXXXX" )"
+    trap 'rm -f "$TMP"' EXIT
+    tar czf "$TMP" -- "$@"
+    # Publish with a rename, so that other checkouts never see a partial entry.
+    mv -f "$TMP" "${STOREDIR}/builds/${KEY}.tar.gz"
+    trap - EXIT
+    echo "$( basename "$PWD" ): $*" >"${STOREDIR}/builds/${KEY}.txt"
+    echo "cdtc_toolstore: saved $* as ${KEY}"
+}
+
+function restore()
+{
+    local KEY="$1"
+    echo "cdtc_toolstore: restoring $( cat "${STOREDIR}/builds/${KEY}.txt" 2>/dev/null || echo "${KEY}" )"
+    # Fresh times, in the order of the archive: stamps stored last come out
+    # newer than what they depend on.
+    tar xzf "${STOREDIR}/builds/${KEY}.tar.gz" --touch
+}
+
+function list()
+{
+    local ENTRY
+    echo "store directory       ${STOREDIR}"
+    echo "sources:"
+    for ENTRY in "${STOREDIR}"/sources/*/url
+    do
+        [[ -r "$ENTRY" ]] || continue
+        printf "  %8s KiB  %s\n" "$( du -sk "${ENTRY%/url}" | cut -f 1 )" "$( cat "$ENTRY" )"
+    done
+    echo "builds:"
+    for ENTRY in "${STOREDIR}"/builds/*.txt
+    do
+        [[ -r "$ENTRY" ]] || continue
+        printf "  %8s KiB  %s  %s\n" "$( du -sk "${ENTRY%.txt}.tar.gz" | cut -f 1 )" "$( basename "${ENTRY%.txt}" )" "$( cat "$ENTRY" )"
+    done
+}
+
+case "${1:-}" in
+    key)
+        [[ $# -ge 3 ]] || usage
+        shift
+        compute_key "$@"
+        ;;
+    has)
+        [[ $# -eq 2 ]] || usage
+        [[ -r "${STOREDIR}/builds/$2.tar.gz" ]]
+        ;;
+    save)
+        [[ $# -ge 3 ]] || usage
+        shift
+        save "$@"
+        ;;
+    restore)
+        [[ $# -eq 2 ]] || usage
+        restore "$2"
+        ;;
+    fetch)
+        [[ $# -ge 3 && $# -le 4 ]] || usage
+        shift
+        fetch "$@"
+        ;;
+    --list)
+        list
+        ;;
+    --export)
+        [[ $# -eq 2 ]] || usage
+        tar cf "$2" -C "$STOREDIR" .
+        ;;
+    --import)
+        [[ $# -eq 2 ]] || usage
+        mkdir -p "$STOREDIR"
+        tar xf "$2" -C "$STOREDIR" --skip-old-files
+        ;;
+    *)
+        usage
+        ;;
+esac
@@ -0,0 +1,56 @@
+########################################################################
+# Tool store, see cdtc_toolstore.sh
+########################################################################
+
+# Included by tool makefiles, once PRODUCT_NAME, URL_DOWNLOAD,
+# TOOLSTORE_STAMP (the file that tells the tool is built) and
+# TOOLSTORE_PATHS (what to store, the stamp last) are set.
+#
+# When the store has a build for the current key, TOOLSTORE_HIT is set
+# and this file provides the rule that restores TOOLSTORE_STAMP: the tool
+# makefile then leaves out its own rule for it, so nothing is downloaded
+# or built.  Otherwise the tool makefile builds as usual, downloads with
+# $(TOOLSTORE_FETCH) and runs $(TOOLSTORE_SAVE) once the stamp is done.
+#
+# make CDTC_TOOLSTORE= builds from source, without stored builds.  Source
+# archives still go through the store.
+
+TOOLSTORE_SCRIPT = ../cdtc_toolstore/cdtc_toolstore.sh
+CDTC_TOOLSTORE ?= $(TOOLSTORE_SCRIPT)
+
+TOOLSTORE_KEY_FILES ?= $(wildcard Makefile Makefile.havesourcetree *_build_patch.patch *.sh)
+
+ifneq ($(CDTC_TOOLSTORE),)
+
+TOOLSTORE_KEY := $(shell $(CDTC_TOOLSTORE) key "$(PRODUCT_NAME)" "$(URL_DOWNLOAD)" $(TOOLSTORE_KEY_FILES))
+
+# A tree restored earlier stays valid even if the store is emptied since.
+TOOLSTORE_HIT := $(shell [[ "$$( cat .toolstore_restored 2>/dev/null )" == "$(TOOLSTORE_KEY)" ]] || $(CDTC_TOOLSTORE) has "$(TOOLSTORE_KEY)" && echo yes)
+
+# .toolstore_key changes when the version, a patch or a build script
+# does, which rebuilds (or restores) the tool.  Created old, so that
+# trees built before the store existed are not rebuilt.
+$(shell if [[ ! -e .toolstore_key ]] ; then echo "$(TOOLSTORE_KEY)" >.toolstore_key ; touch -d @0 .toolstore_key ; \
+	elif [[ "$$( cat .toolstore_key )" != "$(TOOLSTORE_KEY)" ]] ; then echo "$(TOOLSTORE_KEY)" >.toolstore_key ; fi )
+
+$(TOOLSTORE_STAMP): .toolstore_key
+
+TOOLSTORE_SAVE = $(CDTC_TOOLSTORE) save "$(TOOLSTORE_KEY)" $(TOOLSTORE_PATHS)
+
+else
+
+TOOLSTORE_HIT :=
+TOOLSTORE_SAVE = true
+
+endif
+
+TOOLSTORE_FETCH = $(TOOLSTORE_SCRIPT) fetch
+
+ifneq ($(TOOLSTORE_HIT),)
+$(TOOLSTORE_STAMP):
+	@echo "************************************************************************"
+	@echo "**************** Restoring from tool store: $(TOOLSTORE_PATHS)"
+	@echo "************************************************************************"
+	$(CDTC_TOOLSTORE) restore "$(TOOLSTORE_KEY)"
+	echo "$(TOOLSTORE_KEY)" >.toolstore_restored
+endif
@@ -0,0 +1,138 @@
+#!/bin/bash
+
+# Build step timings, in Chrome trace format.
+#
+# Usage:
+#   cdtc_trace.sh CATEGORY NAME command args...
+#                              run command, record how long it took
+#   cdtc_trace.sh --summary [TRACE_FILE]
+#                              show totals per category and slowest steps
+#   cdtc_trace.sh --chrome [TRACE_FILE]
+#                              print the trace as a JSON array, to load in
+#                              chrome://tracing or https://ui.perfetto.dev
+#
+# The makefile runs every build step (compile, assemble, link, packing,
+# disc and tape images, sub-makes that conjure up tools and libraries)
+# through this script.  Each step appends one line to CDTC_TRACE_FILE:
+# a Chrome trace "complete" event, for example
+#
+#   {"name":"main.c","cat":"compile","ph":"X","ts":1700000000000000,"dur":2345678,"pid":1,"tid":4242,"args":{"dir":"/home/me/proj","status":0}}
+#
+# Times are in microseconds.  Each step is its own thread (tid is the
+# process id), so that steps run in parallel by make -j show side by
+# side.  One short append per step is atomic, even with make -j.
+#
+# Environment:
+#   CDTC_TRACE_FILE  where to append, if empty or unset only run command
+#   CDTC_TRACE_TOP   how many steps --summary lists, default 15
+
+set -u -o pipefail
+
+function now_us()
+{
+    if [[ -n "${EPOCHREALTIME:-}" ]]
+    then echo "${EPOCHREALTIME/./}"
+    else date +%s%6N
+    fi
+}
+
+function json_string()
+{
+    local S="$1"
+    S="${S//\\/\\\\}"
+    S="${S//\"/\\\"}"
+    printf '"%s"' "$S"
+}
+
+# Extract "key": values from event lines, one step per output line:
+# category, duration, start, end, name, tab-separated.
+function steps()
+{
+    sed -n 's/^{"name":"\(.*\)","cat":"\([^"]*\)","ph":"X","ts":\([0-9]*\),"dur":\([0-9]*\),.*/\2\t\4\t\3\t\1/p' "$1" \
+    | awk -F '\t' '{ printf "%s\t%s\t%s\t%.0f\t%s\n", $1, $2, $3, $3 + $2, $4 }'
+}
+
+function summary()
+{
+    local TRACE="$1" TOP="${CDTC_TRACE_TOP:-15}"
+
+    if [[ ! -s "$TRACE" ]]
+    then
+        echo "No build step recorded in $TRACE yet."
+        return 0
+    fi
+
+    steps "$TRACE" | awk -F '\t' -v top="$TOP" '
+    {
+        n++
+        cat[n] = $1 ; dur[n] = $2 ; name[n] = $5
+        total += $2
+        percat[$1] += $2 ; countcat[$1]++
+        if (n == 1 || $3 < first) first = $3
+        if (n == 1 || $4 > last) last = $4
+    }
+    END {
+        printf "%d steps, %.1f s of work in %.1f s from first start to last end.\n\n", n, total / 1e6, (last - first) / 1e6
+        printf "Per category:\n"
+        fflush ()
+        for (c in percat)
+            printf "  %-10s %5d steps %8.1f s\n", c, countcat[c], percat[c] / 1e6 | "sort -k4 -rn"
+        close ("sort -k4 -rn")
+        printf "\nSlowest steps:\n"
+        fflush ()
+        for (i = 1; i <= n; i++)
+            printf "  %8.2f s  %-10s %s\n", dur[i] / 1e6, cat[i], name[i] | "sort -rn | head -n " top
+        close ("sort -rn | head -n " top)
+    }'
+}
+
+function chrome()
+{
+    local TRACE="$1" SEP=""
+    echo "["
+    if [[ -r "$TRACE" ]]
+    then
+        while IFS= read -r LINE
+        do
+            printf '%s%s' "$SEP" "$LINE"
+            SEP=$',\n'
+        done <"$TRACE"
+    fi
+    echo
+    echo "]"
+}
+
+case "${1:-}" in
+    --summary)
+        summary "${2:-${CDTC_TRACE_FILE:-}}"
+        exit 0
+        ;;
+    --chrome)
+        chrome "${2:-${CDTC_TRACE_FILE:-}}"
+        exit 0
+        ;;
+esac
+
+if [[ $# -lt 3 ]]
+then
+    echo >&2 "Usage: $0 CATEGORY NAME command args..."
+    exit 2
+fi
+
+CATEGORY="$1"
+NAME="$2"
+shift 2
+
+if [[ -z "${CDTC_TRACE_FILE:-}" ]]
+then
+    exec "$@"
+fi
+
+START=$( now_us )
+"$@"
+STATUS=$?
+END=$( now_us )
+
+echo "{\"name\":$( json_string "$NAME" ),\"cat\":$( json_string "$CATEGORY" ),\"ph\":\"X\",\"ts\":${START},\"dur\":$(( END - START )),\"pid\":1,\"tid\":$$,\"args\":{\"dir\":$( json_string "$PWD" ),\"status\":${STATUS}}}" >>"$CDTC_TRACE_FILE"
+
+exit $STATUS
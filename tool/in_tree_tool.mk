@@ -0,0 +1,51 @@
+########################################################################
+# In-tree tool: nothing to download, just compile
+########################################################################
+
+# Included by the makefiles of tools whose source is in this tree, once
+# PRODUCT_NAME is set.  They may also set SOURCES (default: the .c file
+# named after the tool), HEADERS (more prerequisites) and HOST_LDLIBS.
+
+SHELL=/bin/bash
+
+TARGETS=build_config.inc
+
+.PHONY: all
+
+all: $(TARGETS)
+
+BUILD_TARGET_FILE=$(PRODUCT_NAME)
+
+# Not CFLAGS: an SDCC project calling us may have set CFLAGS for SDCC.
+HOST_CC?=cc
+HOST_CFLAGS?=-O2 -Wall -Wextra
+
+SOURCES?=$(PRODUCT_NAME).c
+
+$(BUILD_TARGET_FILE): $(SOURCES) $(HEADERS) Makefile ../in_tree_tool.mk
+	$(HOST_CC) $(HOST_CFLAGS) -o "$@.tmp" $(SOURCES) $(HOST_LDLIBS)
+	mv -f "$@.tmp" "$@"
+
+build_config.inc: $(BUILD_TARGET_FILE) Makefile ../in_tree_tool.mk
+	(set -eu ; \
+	{ \
+	echo "# with bash do \"source\" this file." ; \
+	echo "export PATH=\"\$${PATH}:$$PWD\"" ; \
+	} >$@ ; )
+
+.PHONY: install
+
+install: $(BUILD_TARGET_FILE)
+	@ if [[ -z "$(PREFIX_BIN)" ]] ; then echo >&2 "PREFIX_BIN not set. Aborting." ; exit 1 ; fi
+	@echo "************************************************************************"
+	@echo "**************** Installing: $^"
+	@echo "************************************************************************"
+	install -s -D -v --target-directory=$(PREFIX_BIN) $(BUILD_TARGET_FILE)
+
+clean:
+	-rm -f $(BUILD_TARGET_FILE) $(BUILD_TARGET_FILE).tmp
+
+mrproper: clean
+	-rm -f $(TARGETS) *~
+
+distclean: mrproper